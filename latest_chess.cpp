@@ -9,8 +9,34 @@
  * The game is played on a console interface where players input moves in algebraic notation.
  */
 
+ #include <algorithm>
+ #include <atomic>
+ #include <chrono>
+ #include <condition_variable>
+ #include <cstdlib>
+ #include <deque>
+ #include <fstream>
  #include <iostream>
+ #include <map>
+ #include <mutex>
+ #include <sstream>
  #include <string>
+ #include <thread>
+ #include <vector>
+ 
+ // PEXT slider lookups need the BMI2 intrinsics, available from GCC and Clang on x86.
+ #if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+ #include <immintrin.h>
+ #define CHESS_HAS_PEXT 1
+ #else
+ #define CHESS_HAS_PEXT 0
+ #endif
+ 
+ // NNUE kernels use AVX2 or SSE4.1 when the compiler targets them (-mavx2, -msse4.1, -march=native),
+ // and plain loops otherwise.
+ #if defined(__AVX2__) || defined(__SSE4_1__)
+ #include <immintrin.h>
+ #endif
  
  using namespace std;
  
@@ -19,6 +45,29 @@
  const int GAME_CHECKMATE = 1; ///< Game ended in checkmate
  const int GAME_STALEMATE = 2; ///< Game ended in stalemate
  
+ // Color indices used by the bitboard representation
+ const int COLOR_WHITE = 0; ///< Index of the white side
+ const int COLOR_BLACK = 1; ///< Index of the black side
+ 
+ /**
+  * @brief A set of squares packed into 64 bits.
+  *
+  * Bit (row * 8 + col) corresponds to board square (row, col), so bit 0 is a8 and bit 63 is h1.
+  */
+ typedef unsigned long long Bitboard;
+ 
+ /**
+  * @brief A 64-bit Zobrist key identifying a position.
+  */
+ typedef unsigned long long HashKey;
+ 
+ // Castling right flags, combined as a bitmask
+ const int CASTLE_WHITE_KINGSIDE = 1;  ///< White may castle kingside
+ const int CASTLE_WHITE_QUEENSIDE = 2; ///< White may castle queenside
+ const int CASTLE_BLACK_KINGSIDE = 4;  ///< Black may castle kingside
+ const int CASTLE_BLACK_QUEENSIDE = 8; ///< Black may castle queenside
+ const int CASTLE_ALL = 15;            ///< All four castling rights
+ 
  /**
   * @brief Converts a string to title case (e.g., "queen" to "Queen").
   * @param input The input string to convert.
@@ -87,8 +136,519 @@
      return Position(rowIndex, colIndex);
  }
  
+ /**
+  * @brief Converts board indices to a square index (0-63).
+  * @param x The row index.
+  * @param y The column index.
+  * @return The square index (row * 8 + col).
+  */
+ inline int squareIndex(int x, int y) { return x * 8 + y; }
+ 
+ /**
+  * @brief Gets the single-bit bitboard for a square.
+  * @param sq The square index.
+  * @return A bitboard with only that square set.
+  */
+ inline Bitboard squareBit(int sq) { return 1ULL << sq; }
+ 
+ /**
+  * @brief Gets the index of the least significant set bit.
+  * @param b A non-empty bitboard.
+  * @return The square index of the lowest set bit.
+  */
+ inline int lsbIndex(Bitboard b) { return __builtin_ctzll(b); }
+ 
+ /**
+  * @brief Removes and returns the least significant set bit.
+  * @param b A non-empty bitboard, modified in place.
+  * @return The square index of the removed bit.
+  */
+ inline int popLsb(Bitboard& b) {
+     int sq = __builtin_ctzll(b);
+     b &= b - 1;
+     return sq;
+ }
+ 
+ /**
+  * @brief Counts the number of set bits.
+  * @param b The bitboard.
+  * @return The number of squares in the set.
+  */
+ inline int popCount(Bitboard b) { return __builtin_popcountll(b); }
+ 
+ constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL; ///< All squares on the a-file.
+ constexpr Bitboard FILE_B_BB = FILE_A_BB << 1;        ///< All squares on the b-file.
+ constexpr Bitboard FILE_G_BB = FILE_A_BB << 6;        ///< All squares on the g-file.
+ constexpr Bitboard FILE_H_BB = FILE_A_BB << 7;        ///< All squares on the h-file.
+ 
+ /**
+  * @brief Computes the squares attacked by a knight with shifts (used to build the tables).
+  * @param sq The knight's square.
+  * @return Bitboard of attacked squares.
+  */
+ constexpr Bitboard computeKnightAttacks(int sq) {
+     Bitboard b = 1ULL << sq;
+     Bitboard l1 = (b >> 1) & ~FILE_H_BB;
+     Bitboard l2 = (b >> 2) & ~(FILE_G_BB | FILE_H_BB);
+     Bitboard r1 = (b << 1) & ~FILE_A_BB;
+     Bitboard r2 = (b << 2) & ~(FILE_A_BB | FILE_B_BB);
+     Bitboard h1 = l1 | r1;
+     Bitboard h2 = l2 | r2;
+     return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
+ }
+ 
+ /**
+  * @brief Computes the squares attacked by a king with shifts (used to build the tables).
+  * @param sq The king's square.
+  * @return Bitboard of attacked squares.
+  */
+ constexpr Bitboard computeKingAttacks(int sq) {
+     Bitboard b = 1ULL << sq;
+     Bitboard row = b | ((b >> 1) & ~FILE_H_BB) | ((b << 1) & ~FILE_A_BB);
+     return (row | (row << 8) | (row >> 8)) & ~b;
+ }
+ 
+ /**
+  * @brief Computes the squares attacked by a pawn with shifts (used to build the tables).
+  * @param color The pawn's color index (COLOR_WHITE or COLOR_BLACK).
+  * @param sq The pawn's square.
+  * @return Bitboard of the (at most two) diagonally attacked squares.
+  */
+ constexpr Bitboard computePawnAttacks(int color, int sq) {
+     Bitboard b = 1ULL << sq;
+     Bitboard ahead = (color == COLOR_WHITE) ? (b >> 8) : (b << 8);
+     return ((ahead >> 1) & ~FILE_H_BB) | ((ahead << 1) & ~FILE_A_BB);
+ }
+ 
+ /**
+  * @brief Attack sets of the non-sliding pieces for every square, built at compile time.
+  */
+ struct LeaperAttacks {
+     Bitboard knight[64];  ///< Knight attacks by square.
+     Bitboard king[64];    ///< King attacks by square.
+     Bitboard pawn[2][64]; ///< Pawn attacks by color and square.
+ 
+     constexpr LeaperAttacks() : knight(), king(), pawn() {
+         for (int sq = 0; sq < 64; sq++) {
+             knight[sq] = computeKnightAttacks(sq);
+             king[sq] = computeKingAttacks(sq);
+             pawn[COLOR_WHITE][sq] = computePawnAttacks(COLOR_WHITE, sq);
+             pawn[COLOR_BLACK][sq] = computePawnAttacks(COLOR_BLACK, sq);
+         }
+     }
+ };
+ 
+ constexpr LeaperAttacks LEAPER_ATTACKS; ///< The precomputed knight, king and pawn attack tables.
+ 
+ /**
+  * @brief Gets the squares attacked by a knight.
+  * @param sq The knight's square.
+  * @return Bitboard of attacked squares.
+  */
+ inline Bitboard knightAttacks(int sq) { return LEAPER_ATTACKS.knight[sq]; }
+ 
+ /**
+  * @brief Gets the squares attacked by a king.
+  * @param sq The king's square.
+  * @return Bitboard of attacked squares.
+  */
+ inline Bitboard kingAttacks(int sq) { return LEAPER_ATTACKS.king[sq]; }
+ 
+ /**
+  * @brief Gets the squares attacked by a pawn.
+  * @param color The pawn's color index (COLOR_WHITE or COLOR_BLACK).
+  * @param sq The pawn's square.
+  * @return Bitboard of the (at most two) diagonally attacked squares.
+  */
+ inline Bitboard pawnAttacks(int color, int sq) { return LEAPER_ATTACKS.pawn[color][sq]; }
+ 
+ /**
+  * @brief Squares between and through every aligned pair of squares, built at compile time.
+  */
+ struct LineTables {
+     Bitboard between[64][64]; ///< Squares strictly between two squares on a line (0 if not aligned).
+     Bitboard line[64][64];    ///< The whole rank, file or diagonal through two squares (0 if not aligned).
+ 
+     constexpr LineTables() : between(), line() {
+         const int steps[8][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+         for (int sq = 0; sq < 64; sq++) {
+             for (int d = 0; d < 8; d++) {
+                 Bitboard full = 1ULL << sq;
+                 for (int k = -7; k <= 7; k++) {
+                     int x = sq / 8 + k * steps[d][0], y = sq % 8 + k * steps[d][1];
+                     if (x >= 0 && x < 8 && y >= 0 && y < 8) full |= 1ULL << (x * 8 + y);
+                 }
+                 Bitboard path = 0;
+                 int x = sq / 8 + steps[d][0], y = sq % 8 + steps[d][1];
+                 while (x >= 0 && x < 8 && y >= 0 && y < 8) {
+                     between[sq][x * 8 + y] = path;
+                     line[sq][x * 8 + y] = full;
+                     path |= 1ULL << (x * 8 + y);
+                     x += steps[d][0];
+                     y += steps[d][1];
+                 }
+             }
+         }
+     }
+ };
+ 
+ constexpr LineTables LINE_TABLES; ///< The precomputed between and line tables.
+ 
+ /**
+  * @brief Gets the squares strictly between two squares.
+  * @param a The first square.
+  * @param b The second square.
+  * @return The squares between them, or 0 if they do not share a rank, file or diagonal.
+  */
+ inline Bitboard betweenBB(int a, int b) { return LINE_TABLES.between[a][b]; }
+ 
+ /**
+  * @brief Gets the full line through two squares.
+  * @param a The first square.
+  * @param b The second square.
+  * @return The rank, file or diagonal through both, or 0 if they are not aligned.
+  */
+ inline Bitboard lineBB(int a, int b) { return LINE_TABLES.line[a][b]; }
+ 
+ /**
+  * @brief Computes sliding attacks along a set of directions, stopping at the first blocker.
+  * @param sq The slider's square.
+  * @param occupied Bitboard of all occupied squares.
+  * @param dirs Four (row, col) step directions.
+  * @return Bitboard of attacked squares, including the blockers themselves.
+  */
+ inline Bitboard slidingAttacks(int sq, Bitboard occupied, const int dirs[4][2]) {
+     Bitboard attacks = 0;
+     for (int d = 0; d < 4; d++) {
+         int x = sq / 8 + dirs[d][0];
+         int y = sq % 8 + dirs[d][1];
+         while (x >= 0 && x < 8 && y >= 0 && y < 8) {
+             Bitboard bit = squareBit(squareIndex(x, y));
+             attacks |= bit;
+             if (occupied & bit) break;
+             x += dirs[d][0];
+             y += dirs[d][1];
+         }
+     }
+     return attacks;
+ }
+ 
+ const int ROOK_DIRECTIONS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};    ///< Orthogonal steps.
+ const int BISHOP_DIRECTIONS[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}}; ///< Diagonal steps.
+ 
+ #if CHESS_HAS_PEXT
+ /**
+  * @brief Extracts the occupancy bits under a mask with the BMI2 PEXT instruction.
+  *
+  * Compiled for BMI2 on its own, so the rest of the program still runs on CPUs without it;
+  * only call it once the CPU is known to support BMI2.
+  * @param occupied Bitboard of all occupied squares.
+  * @param mask The squares whose occupancy matters.
+  * @return The masked bits packed into the low bits.
+  */
+ __attribute__((target("bmi2"))) inline unsigned pextIndex(Bitboard occupied, Bitboard mask) {
+     return (unsigned)_pext_u64(occupied, mask);
+ }
+ #endif
+ 
+ /**
+  * @brief Rook magic multipliers for this board's square numbering (a8 = 0), one per square.
+  *
+  * Found with the fixed-seed search in SliderAttacks::build and checked again at startup.
+  */
+ const Bitboard ROOK_MAGICS[64] = {
+     0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+     0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+     0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+     0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+     0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+     0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+     0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+     0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+     0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+     0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+     0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+     0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+     0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+     0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+     0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+     0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+ };
+ 
+ /**
+  * @brief Bishop magic multipliers for this board's square numbering (a8 = 0), one per square.
+  */
+ const Bitboard BISHOP_MAGICS[64] = {
+     0x2048017020910100ULL, 0x0044410424008008ULL, 0x040828A400900000ULL, 0x8002209200022000ULL,
+     0x0002021000540002ULL, 0x0021018840000000ULL, 0x00009E8420204002ULL, 0x00A0920110084480ULL,
+     0x4003062018010110ULL, 0x0221046812004E09ULL, 0x01E11002958912A0ULL, 0x0000044410804000ULL,
+     0x0000821210000080ULL, 0x080201102210A800ULL, 0x0080040411045004ULL, 0x00704A1842021000ULL,
+     0x1005061070322800ULL, 0x0018001010410444ULL, 0x0010000800401420ULL, 0x2204002844000800ULL,
+     0x2052020412022280ULL, 0x000A020101008208ULL, 0x0040400201042000ULL, 0x03E1082040480410ULL,
+     0x1004200004208414ULL, 0x08700400984808C8ULL, 0x0088080004004410ULL, 0x008C0240140100A2ULL,
+     0x0008840001822000ULL, 0x0050088001080100ULL, 0x98140840040A2200ULL, 0x3002020900210110ULL,
+     0x1004040640206000ULL, 0x1090909000840400ULL, 0x9002444810100020ULL, 0x4000020080080080ULL,
+     0x0028020400011010ULL, 0x0290808300020100ULL, 0x8010020882004410ULL, 0x0604010040082C20ULL,
+     0x20040104C0801008ULL, 0x6004208424001050ULL, 0x1002840041000800ULL, 0x0200042018000102ULL,
+     0xA8002000A0821C00ULL, 0x0040080802201910ULL, 0x0222620444000100ULL, 0x0002080041020088ULL,
+     0x1500820110401050ULL, 0x0000492090100080ULL, 0x0900410041100000ULL, 0x0302000420880000ULL,
+     0x0010501202020020ULL, 0x0008200490049040ULL, 0x0462080214A40120ULL, 0x2421310102008100ULL,
+     0x2400420080884060ULL, 0x0800804406184208ULL, 0x0B0080124A084400ULL, 0x082E082300840412ULL,
+     0x6051049040082200ULL, 0xC610211002102101ULL, 0x0000048808010433ULL, 0x0010200804405440ULL
+ };
+ 
+ /**
+  * @brief Lookup data for one slider on one square.
+  */
+ struct SliderEntry {
+     Bitboard mask;      ///< Squares whose occupancy can block the slider (board edges excluded).
+     Bitboard magic;     ///< Magic multiplier mapping masked occupancies to table indices.
+     Bitboard* attacks;  ///< This square's slice of the attack table.
+     int shift;          ///< 64 minus the number of mask bits.
+ };
+ 
+ /**
+  * @brief Rook and bishop attack tables indexed by occupancy.
+  *
+  * Two backends fill the same tables: fancy magic bitboards, which work on any CPU, and
+  * BMI2 PEXT, which packs the masked occupancy directly into an index. PEXT is used when the
+  * compiler targets BMI2 or the CPU reports it at startup; otherwise the precomputed magics
+  * are used (published magics assume a1 = bit 0, while this board has a8 = bit 0).
+  */
+ class SliderAttacks {
+ private:
+     static const int ROOK_TABLE_SIZE = 102400;  ///< Sum of 2^bits over all rook masks.
+     static const int BISHOP_TABLE_SIZE = 5248;  ///< Sum of 2^bits over all bishop masks.
+ 
+     SliderEntry rookEntries[64];                ///< Rook lookup data by square.
+     SliderEntry bishopEntries[64];              ///< Bishop lookup data by square.
+     Bitboard rookTable[ROOK_TABLE_SIZE];        ///< Rook attacks for every square and occupancy.
+     Bitboard bishopTable[BISHOP_TABLE_SIZE];    ///< Bishop attacks for every square and occupancy.
+     bool pext;                                  ///< True if tables are indexed with PEXT.
+ 
+     /**
+      * @brief Computes the table index of an occupancy for one entry.
+      * @param entry The slider's lookup data.
+      * @param occupied Bitboard of all occupied squares.
+      * @return Index into the entry's slice of the table.
+      */
+     unsigned index(const SliderEntry& entry, Bitboard occupied) const {
+ #if CHESS_HAS_PEXT && defined(__BMI2__)
+         return (unsigned)_pext_u64(occupied, entry.mask);
+ #else
+ #if CHESS_HAS_PEXT
+         if (pext) return pextIndex(occupied, entry.mask);
+ #endif
+         return (unsigned)(((occupied & entry.mask) * entry.magic) >> entry.shift);
+ #endif
+     }
+ 
+     /**
+      * @brief Fills one slider's entries and attack table.
+      * @param entries The 64 entries to fill.
+      * @param table The attack table shared by all squares.
+      * @param dirs The slider's step directions.
+      * @param magics The precomputed magic for each square.
+      * @param seed Starting state of the generator used if a precomputed magic does not fit.
+      */
+     void build(SliderEntry entries[64], Bitboard* table, const int dirs[4][2], const Bitboard magics[64],
+                unsigned long long seed) {
+         static Bitboard occupancies[4096], reference[4096];
+         static int epoch[4096];  // Attempt that last wrote each index, so slots need no clearing per attempt.
+         fill(epoch, epoch + 4096, 0);  // ...but attempts restart at 0 on every build.
+         int attempt = 0;
+         Bitboard* next = table;
+         for (int sq = 0; sq < 64; sq++) {
+             SliderEntry& entry = entries[sq];
+             Bitboard rankEdges = (0xFFULL | (0xFFULL << 56)) & ~(0xFFULL << (sq / 8 * 8));
+             Bitboard fileEdges = (FILE_A_BB | FILE_H_BB) & ~(FILE_A_BB << (sq % 8));
+             entry.mask = slidingAttacks(sq, 0, dirs) & ~(rankEdges | fileEdges);
+             entry.shift = 64 - popCount(entry.mask);
+             entry.attacks = next;
+             entry.magic = 0;
+ 
+             // Enumerate every subset of the mask (carry-rippler) with its true attack set.
+             int size = 0;
+             Bitboard subset = 0;
+             do {
+                 occupancies[size] = subset;
+                 reference[size++] = slidingAttacks(sq, subset, dirs);
+                 subset = (subset - entry.mask) & entry.mask;
+             } while (subset);
+             next += size;
+ 
+             if (pext) {
+                 for (int i = 0; i < size; i++) entry.attacks[index(entry, occupancies[i])] = reference[i];
+                 continue;
+             }
+ 
+             // Check the precomputed magic; should it collide, search sparse random multipliers
+             // until one maps the subsets without destructive collisions.
+             entry.magic = magics[sq];
+             bool found = false;
+             for (int tries = 0; !found; tries++) {
+                 if (tries > 0) {
+                     do {
+                         entry.magic = ~0ULL;
+                         for (int k = 0; k < 3; k++) {
+                             seed ^= seed >> 12;
+                             seed ^= seed << 25;
+                             seed ^= seed >> 27;
+                             entry.magic &= seed * 2685821657736338717ULL;
+                         }
+                     } while (popCount((entry.mask * entry.magic) >> 56) < 6);
+                 }
+                 attempt++;
+                 found = true;
+                 for (int i = 0; i < size && found; i++) {
+                     unsigned idx = index(entry, occupancies[i]);
+                     if (epoch[idx] < attempt) {
+                         epoch[idx] = attempt;
+                         entry.attacks[idx] = reference[i];
+                     } else if (entry.attacks[idx] != reference[i]) {
+                         found = false;
+                     }
+                 }
+             }
+         }
+     }
+ 
+ public:
+     /**
+      * @brief Builds both tables, choosing the backend.
+      * @param allowPext True to use PEXT when the CPU supports it, false to force magics.
+      */
+     explicit SliderAttacks(bool allowPext) : pext(false) {
+ #if CHESS_HAS_PEXT && defined(__BMI2__)
+         (void)allowPext;
+         pext = true;
+ #elif CHESS_HAS_PEXT
+         // This runs from a static initializer, possibly before libgcc has probed the CPU.
+         __builtin_cpu_init();
+         pext = allowPext && __builtin_cpu_supports("bmi2");
+ #else
+         (void)allowPext;
+ #endif
+         build(rookEntries, rookTable, ROOK_DIRECTIONS, ROOK_MAGICS, 0x9E3779B97F4A7C15ULL);
+         build(bishopEntries, bishopTable, BISHOP_DIRECTIONS, BISHOP_MAGICS, 0xD1B54A32D192ED03ULL);
+     }
+ 
+     /**
+      * @brief Looks up rook attacks.
+      * @param sq The rook's square.
+      * @param occupied Bitboard of all occupied squares.
+      * @return Bitboard of attacked squares.
+      */
+     Bitboard rook(int sq, Bitboard occupied) const {
+         const SliderEntry& entry = rookEntries[sq];
+         return entry.attacks[index(entry, occupied)];
+     }
+ 
+     /**
+      * @brief Looks up bishop attacks.
+      * @param sq The bishop's square.
+      * @param occupied Bitboard of all occupied squares.
+      * @return Bitboard of attacked squares.
+      */
+     Bitboard bishop(int sq, Bitboard occupied) const {
+         const SliderEntry& entry = bishopEntries[sq];
+         return entry.attacks[index(entry, occupied)];
+     }
+ 
+     /**
+      * @brief Names the backend in use.
+      * @return "pext" or "magic".
+      */
+     const char* backendName() const { return pext ? "pext" : "magic"; }
+ };
+ 
+ const SliderAttacks SLIDER_ATTACKS(true); ///< The slider tables, built once at startup.
+ 
+ /**
+  * @brief Computes rook attacks for a given occupancy.
+  * @param sq The rook's square.
+  * @param occupied Bitboard of all occupied squares.
+  * @return Bitboard of attacked squares.
+  */
+ inline Bitboard rookAttacks(int sq, Bitboard occupied) { return SLIDER_ATTACKS.rook(sq, occupied); }
+ 
+ /**
+  * @brief Computes bishop attacks for a given occupancy.
+  * @param sq The bishop's square.
+  * @param occupied Bitboard of all occupied squares.
+  * @return Bitboard of attacked squares.
+  */
+ inline Bitboard bishopAttacks(int sq, Bitboard occupied) { return SLIDER_ATTACKS.bishop(sq, occupied); }
+ 
+ /**
+  * @brief Random keys for Zobrist hashing of positions.
+  *
+  * A position's key is the XOR of the keys of its pieces, castling rights, en passant file
+  * and side to move, so a move updates it with a handful of XORs.
+  */
+ class ZobristKeys {
+ public:
+     HashKey piece[2][6][64]; ///< Key per color, piece type and square.
+     HashKey castling[16];    ///< Key per castling rights bitmask.
+     HashKey enPassant[8];    ///< Key per en passant file.
+     HashKey blackToMove;     ///< Key toggled when black is to move.
+ 
+     /**
+      * @brief Fills the tables from a fixed-seed generator so keys are stable between runs.
+      */
+     ZobristKeys() {
+         HashKey seed = 1070372ULL;
+         for (int c = 0; c < 2; c++)
+             for (int t = 0; t < 6; t++)
+                 for (int sq = 0; sq < 64; sq++) piece[c][t][sq] = next(seed);
+         for (int i = 0; i < 16; i++) castling[i] = next(seed);
+         for (int i = 0; i < 8; i++) enPassant[i] = next(seed);
+         blackToMove = next(seed);
+     }
+ 
+ private:
+     /**
+      * @brief Advances a xorshift64* generator.
+      * @param state The generator state, modified in place.
+      * @return The next pseudo-random value.
+      */
+     static HashKey next(HashKey& state) {
+         state ^= state >> 12;
+         state ^= state << 25;
+         state ^= state >> 27;
+         return state * 2685821657736338717ULL;
+     }
+ };
+ 
+ const ZobristKeys ZOBRIST; ///< The Zobrist keys shared by every board.
+ 
+ /**
+  * @brief Castling rights that survive a move touching each square.
+  *
+  * Moving from or to a king or rook home square clears the rights that depend on it.
+  */
+ const int CASTLING_RIGHTS_MASK[64] = {
+     ~CASTLE_BLACK_QUEENSIDE & CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     ~(CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE) & CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     ~CASTLE_BLACK_KINGSIDE & CASTLE_ALL,
+     CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     ~CASTLE_WHITE_QUEENSIDE & CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     ~(CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE) & CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+     ~CASTLE_WHITE_KINGSIDE & CASTLE_ALL
+ };
+ 
+ const string COLOR_NAMES[2] = {"White", "Black"}; ///< Display names indexed by color index.
+ 
  /**
   * @brief Abstract base class for all chess pieces.
+  *
+  * The board stores pieces as one-byte codes; ChessPiece objects are read-only views used for
+  * display and attack queries. Move legality lives only in ChessBoard's move generator.
   */
  class ChessPiece : public Displayable {
  public:
@@ -100,9 +660,8 @@
      static const int KING_TYPE = 5;   ///< Type identifier for King.
  
  protected:
-     string color;    ///< Color of the piece ("White" or "Black").
+     int side;        ///< Color index of the piece (COLOR_WHITE or COLOR_BLACK).
      int x, y;        ///< Position of the piece on the board (row, col).
-     bool hasMoved;   ///< Tracks if the piece has moved (for castling and pawn double moves).
      int type;        ///< Type of the piece (PAWN_TYPE, ROOK_TYPE, etc.).
  
  public:
@@ -114,20 +673,10 @@
       * @param t Type of the piece.
       */
      ChessPiece(string col, int xPos, int yPos, int t)
-         : color(col), x(xPos), y(yPos), hasMoved(false), type(t) {}
+         : side(col == "White" ? COLOR_WHITE : COLOR_BLACK), x(xPos), y(yPos), type(t) {}
  
      virtual ~ChessPiece() {}
  
-     /**
-      * @brief Attempts to move the piece to a new position.
-      * @param newX The target row.
-      * @param newY The target column.
-      * @param board The chessboard to move on.
-      * @param needsPromotion Output parameter indicating if a pawn needs promotion.
-      * @return True if the move is valid and executed, false otherwise.
-      */
-     virtual bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion) = 0;
- 
      /**
       * @brief Displays the piece's symbol to the console.
       */
@@ -152,7 +701,13 @@
       * @brief Gets the color of the piece.
       * @return The color ("White" or "Black").
       */
-     string getColor() const { return color; }
+     const string& getColor() const { return COLOR_NAMES[side]; }
+ 
+     /**
+      * @brief Gets the color index of the piece.
+      * @return COLOR_WHITE or COLOR_BLACK.
+      */
+     int getColorIndex() const { return side; }
  
      /**
       * @brief Gets the row position of the piece.
@@ -166,29 +721,6 @@
       */
      int getY() const { return y; }
  
-     /**
-      * @brief Sets the position of the piece and marks it as moved.
-      * @param newX The new row.
-      * @param newY The new column.
-      */
-     void setPosition(int newX, int newY) { x = newX; y = newY; hasMoved = true; }
- 
-     /**
-      * @brief Temporarily sets the position for attack checks (used during simulations).
-      * @param newX The temporary row.
-      * @param newY The temporary column.
-      */
-     void setPositionForAttack(int newX, int newY) const {
-         const_cast<ChessPiece*>(this)->x = newX;
-         const_cast<ChessPiece*>(this)->y = newY;
-     }
- 
-     /**
-      * @brief Checks if the piece has moved.
-      * @return True if the piece has moved, false otherwise.
-      */
-     bool getHasMoved() const { return hasMoved; }
- 
      /**
       * @brief Gets the type of the piece.
       * @return The piece type (e.g., PAWN_TYPE, KING_TYPE).
@@ -209,9 +741,8 @@
       */
      Pawn(string col, int xPos, int yPos) : ChessPiece(col, xPos, yPos, PAWN_TYPE) {}
  
-     bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion);
      bool canAttack(int targetX, int targetY, const class ChessBoard& board) const;
-     string getSymbol() const { return color == "White" ? "♟" : "♙"; }
+     string getSymbol() const { return side == COLOR_WHITE ? "♟" : "♙"; }
  };
  
  /**
@@ -227,9 +758,8 @@
       */
      Rook(string col, int xPos, int yPos) : ChessPiece(col, xPos, yPos, ROOK_TYPE) {}
  
-     bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion);
      bool canAttack(int targetX, int targetY, const class ChessBoard& board) const;
-     string getSymbol() const { return color == "White" ? "♜" : "♖"; }
+     string getSymbol() const { return side == COLOR_WHITE ? "♜" : "♖"; }
  };
  
  /**
@@ -245,9 +775,8 @@
       */
      Knight(string col, int xPos, int yPos) : ChessPiece(col, xPos, yPos, KNIGHT_TYPE) {}
  
-     bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion);
      bool canAttack(int targetX, int targetY, const class ChessBoard& board) const;
-     string getSymbol() const { return color == "White" ? "♞" : "♘"; }
+     string getSymbol() const { return side == COLOR_WHITE ? "♞" : "♘"; }
  };
  
  /**
@@ -263,9 +792,8 @@
       */
      Bishop(string col, int xPos, int yPos) : ChessPiece(col, xPos, yPos, BISHOP_TYPE) {}
  
-     bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion);
      bool canAttack(int targetX, int targetY, const class ChessBoard& board) const;
-     string getSymbol() const { return color == "White" ? "♝" : "♗"; }
+     string getSymbol() const { return side == COLOR_WHITE ? "♝" : "♗"; }
  };
  
  /**
@@ -281,9 +809,8 @@
       */
      Queen(string col, int xPos, int yPos) : ChessPiece(col, xPos, yPos, QUEEN_TYPE) {}
  
-     bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion);
      bool canAttack(int targetX, int targetY, const class ChessBoard& board) const;
-     string getSymbol() const { return color == "White" ? "♛" : "♕"; }
+     string getSymbol() const { return side == COLOR_WHITE ? "♛" : "♕"; }
  };
  
  /**
@@ -299,757 +826,4058 @@
       */
      King(string col, int xPos, int yPos) : ChessPiece(col, xPos, yPos, KING_TYPE) {}
  
-     bool move(int newX, int newY, class ChessBoard& board, bool& needsPromotion);
      bool canAttack(int targetX, int targetY, const class ChessBoard& board) const;
-     string getSymbol() const { return color == "White" ? "♚" : "♔"; }
+     string getSymbol() const { return side == COLOR_WHITE ? "♚" : "♔"; }
  };
  
  /**
-  * @brief Represents a single square on the chessboard.
+  * @brief Creates a new piece of the given type.
+  * @param type The piece type (e.g., ChessPiece::QUEEN_TYPE).
+  * @param color Color of the piece ("White" or "Black").
+  * @param x Row position on the board.
+  * @param y Column position on the board.
+  * @return The newly allocated piece, or nullptr for an unknown type.
   */
- class Square {
+ ChessPiece* createPiece(int type, const string& color, int x, int y) {
+     switch (type) {
+         case ChessPiece::PAWN_TYPE: return new Pawn(color, x, y);
+         case ChessPiece::ROOK_TYPE: return new Rook(color, x, y);
+         case ChessPiece::KNIGHT_TYPE: return new Knight(color, x, y);
+         case ChessPiece::BISHOP_TYPE: return new Bishop(color, x, y);
+         case ChessPiece::QUEEN_TYPE: return new Queen(color, x, y);
+         case ChessPiece::KING_TYPE: return new King(color, x, y);
+     }
+     return nullptr;
+ }
+ 
+ /**
+  * @brief A piece stored as one byte: bit 3 is the color, bits 0-2 are the type plus one.
+  *
+  * NO_PIECE (0) marks an empty square.
+  */
+ typedef unsigned char PieceCode;
+ 
+ const PieceCode NO_PIECE = 0; ///< Code of an empty square.
+ 
+ /**
+  * @brief Builds a piece code.
+  * @param color The color index.
+  * @param type The piece type.
+  * @return The packed code.
+  */
+ inline PieceCode makePiece(int color, int type) { return (PieceCode)((color << 3) | (type + 1)); }
+ 
+ /**
+  * @brief Gets the type of a piece code.
+  * @param code A non-empty piece code.
+  * @return The piece type.
+  */
+ inline int pieceType(PieceCode code) { return (code & 7) - 1; }
+ 
+ /**
+  * @brief Gets the color of a piece code.
+  * @param code A non-empty piece code.
+  * @return The color index.
+  */
+ inline int pieceColor(PieceCode code) { return code >> 3; }
+ 
+ /**
+  * @brief Read-only ChessPiece objects for every piece code on every square.
+  *
+  * getPieceAt hands these out so callers keep the object interface while the board itself
+  * stores only bytes. The table is built once and never changes, so it is safe to share
+  * between threads.
+  */
+ class PieceViews {
  private:
-     ChessPiece* piece; ///< The piece occupying this square (nullptr if empty).
+     ChessPiece* views[16][64]; ///< One view per piece code and square (nullptr for unused codes).
+ 
+     PieceViews() {
+         for (int code = 0; code < 16; code++) {
+             for (int sq = 0; sq < 64; sq++) {
+                 bool valid = (code & 7) >= 1 && (code & 7) <= 6;
+                 views[code][sq] = valid ? createPiece(pieceType((PieceCode)code), COLOR_NAMES[pieceColor((PieceCode)code)],
+                                                       sq / 8, sq % 8)
+                                         : nullptr;
+             }
+         }
+     }
+ 
+     ~PieceViews() {
+         for (int code = 0; code < 16; code++) {
+             for (int sq = 0; sq < 64; sq++) delete views[code][sq];
+         }
+     }
  
  public:
      /**
-      * @brief Constructs an empty Square.
+      * @brief Gets the view of a piece standing on a square.
+      * @param code The piece code (NO_PIECE gives nullptr).
+      * @param sq The square index.
+      * @return The shared read-only view, or nullptr for an empty square.
       */
-     Square() : piece(nullptr) {}
+     static const ChessPiece* get(PieceCode code, int sq) {
+         static const PieceViews table;
+         return table.views[code][sq];
+     }
+ };
+ 
+ /**
+  * @brief Represents a single square on the chessboard.
+  */
+ class Square {
+ private:
+     PieceCode piece; ///< The piece occupying this square (NO_PIECE if empty).
  
+ public:
      /**
-      * @brief Destroys the Square and deletes the piece it contains.
+      * @brief Constructs an empty Square.
       */
-     ~Square() { delete piece; }
+     Square() : piece(NO_PIECE) {}
  
      /**
       * @brief Sets the piece on this square.
-      * @param p The piece to place on the square (can be nullptr).
+      * @param p The piece code to place on the square (NO_PIECE to empty it).
       */
-     void setPiece(ChessPiece* p) { piece = p; }
+     void setPiece(PieceCode p) { piece = p; }
  
      /**
       * @brief Gets the piece on this square.
-      * @return Pointer to the piece, or nullptr if the square is empty.
+      * @return The piece code, or NO_PIECE if the square is empty.
       */
-     ChessPiece* getPiece() const { return piece; }
+     PieceCode getPiece() const { return piece; }
  };
  
  /**
-  * @brief Represents the chessboard and manages game state.
+  * @brief Converts a square index to algebraic notation.
+  * @param sq The square index.
+  * @return The square name (e.g., "e4").
   */
- class ChessBoard : public Displayable {
+ string squareName(int sq) {
+     string name;
+     name += char('a' + sq % 8);
+     name += char('8' - sq / 8);
+     return name;
+ }
+ 
+ /**
+  * @brief Represents a chess move from one position to another.
+  *
+  * The move is packed into 16 bits: starting square, ending square, promotion piece and
+  * move kind, so move lists stay small enough to live on the stack.
+  */
+ class Move {
+ public:
+     static const int NORMAL = 0;     ///< Ordinary move or capture.
+     static const int PROMOTION = 1;  ///< Pawn promotion (with or without capture).
+     static const int EN_PASSANT = 2; ///< En passant capture.
+     static const int CASTLING = 3;   ///< Castling, encoded as the king's two-square move.
+ 
  private:
-     Square squares[8][8];                ///< 8x8 grid of squares.
-     int lastMoveFromX, lastMoveFromY;    ///< Coordinates of the last move's starting position.
-     int lastMoveToX, lastMoveToY;        ///< Coordinates of the last move's ending position.
-     bool lastMoveWasPawnTwoSquares;      ///< Tracks if the last move was a pawn double move (for en passant).
-     int halfMoveClock;                   ///< Counter for the 50-move draw rule.
-     string positionHistory[1000];        ///< History of board positions for threefold repetition.
-     int positionCount;                   ///< Number of positions in the history.
+     unsigned short data; ///< from | to << 6 | promotion index << 12 | kind << 14.
  
      /**
-      * @brief Generates a hash of the current board position for threefold repetition.
-      * @return A string representing the board state, including castling and en passant info.
+      * @brief Maps a promotion piece type to its 2-bit index.
+      * @param type The piece type (Knight, Bishop, Rook or Queen).
+      * @return The index stored in the move.
       */
-     string getPositionHash() const {
-         string hash;
-         for (int i = 0; i < 8; i++) {
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = squares[i][j].getPiece();
-                 if (piece) {
-                     hash += piece->getSymbol();
-                 } else {
-                     hash += '.';
-                 }
-             }
-         }
-         hash += canCastle("White", true) ? "WKS" : "";
-         hash += canCastle("White", false) ? "WQS" : "";
-         hash += canCastle("Black", true) ? "BKS" : "";
-         hash += canCastle("Black", false) ? "BQS" : "";
-         if (lastMoveWasPawnTwoSquares) {
-             int enPassantX = (lastMoveFromX + lastMoveToX) / 2;
-             hash += algebraicFromIndices(enPassantX, lastMoveToY);
-         }
-         return hash;
+     static int promotionIndex(int type) {
+         if (type == ChessPiece::KNIGHT_TYPE) return 0;
+         if (type == ChessPiece::BISHOP_TYPE) return 1;
+         if (type == ChessPiece::ROOK_TYPE) return 2;
+         return 3;
      }
  
  public:
      /**
-      * @brief Constructs an empty ChessBoard.
+      * @brief Constructs an empty (null) move.
       */
-     ChessBoard() : lastMoveFromX(-1), lastMoveFromY(-1), lastMoveToX(-1), lastMoveToY(-1),
-                    lastMoveWasPawnTwoSquares(false), halfMoveClock(0), positionCount(0) {
-         for (int i = 0; i < 1000; i++) positionHistory[i] = "";
-     }
+     Move() : data(0) {}
  
      /**
-      * @brief Destroys the ChessBoard and its squares.
+      * @brief Constructs a Move.
+      * @param fx Starting row.
+      * @param fy Starting column.
+      * @param tx Ending row.
+      * @param ty Ending column.
+      * @param kind The move kind (NORMAL, PROMOTION, EN_PASSANT or CASTLING).
+      * @param promotionType The piece type promoted to, for PROMOTION moves.
       */
-     ~ChessBoard() {}
+     Move(int fx, int fy, int tx, int ty, int kind = NORMAL, int promotionType = ChessPiece::QUEEN_TYPE)
+         : data((unsigned short)(squareIndex(fx, fy) | (squareIndex(tx, ty) << 6) |
+                                 (promotionIndex(promotionType) << 12) | (kind << 14))) {}
  
      /**
-      * @brief Initializes the board with the standard chess starting position.
+      * @brief Gets the starting row.
+      * @return The starting row index.
       */
-     void initializeBoard() {
-         for (int i = 0; i < 8; i++) {
-             squares[1][i].setPiece(new Pawn("Black", 1, i));
-             squares[6][i].setPiece(new Pawn("White", 6, i));
-         }
-         squares[0][0].setPiece(new Rook("Black", 0, 0));
-         squares[0][7].setPiece(new Rook("Black", 0, 7));
-         squares[7][0].setPiece(new Rook("White", 7, 0));
-         squares[7][7].setPiece(new Rook("White", 7, 7));
-         squares[0][1].setPiece(new Knight("Black", 0, 1));
-         squares[0][6].setPiece(new Knight("Black", 0, 6));
-         squares[7][1].setPiece(new Knight("White", 7, 1));
-         squares[7][6].setPiece(new Knight("White", 7, 6));
-         squares[0][2].setPiece(new Bishop("Black", 0, 2));
-         squares[0][5].setPiece(new Bishop("Black", 0, 5));
-         squares[7][2].setPiece(new Bishop("White", 7, 2));
-         squares[7][5].setPiece(new Bishop("White", 7, 5));
-         squares[0][3].setPiece(new Queen("Black", 0, 3));
-         squares[7][3].setPiece(new Queen("White", 7, 3));
-         squares[0][4].setPiece(new King("Black", 0, 4));
-         squares[7][4].setPiece(new King("White", 7, 4));
-     }
+     int getFromX() const { return getFrom() / 8; }
+ 
+     /**
+      * @brief Gets the starting column.
+      * @return The starting column index.
+      */
+     int getFromY() const { return getFrom() % 8; }
+ 
+     /**
+      * @brief Gets the ending row.
+      * @return The ending row index.
+      */
+     int getToX() const { return getTo() / 8; }
+ 
+     /**
+      * @brief Gets the ending column.
+      * @return The ending column index.
+      */
+     int getToY() const { return getTo() % 8; }
+ 
+     /**
+      * @brief Gets the starting square index.
+      * @return The square index (0-63).
+      */
+     int getFrom() const { return data & 63; }
+ 
+     /**
+      * @brief Gets the ending square index.
+      * @return The square index (0-63).
+      */
+     int getTo() const { return (data >> 6) & 63; }
+ 
+     /**
+      * @brief Gets the move kind.
+      * @return NORMAL, PROMOTION, EN_PASSANT or CASTLING.
+      */
+     int getKind() const { return data >> 14; }
+ 
+     /**
+      * @brief Gets the piece type a pawn promotes to.
+      * @return The promotion piece type (only meaningful for PROMOTION moves).
+      */
+     int getPromotionType() const {
+         static const int types[4] = {ChessPiece::KNIGHT_TYPE, ChessPiece::BISHOP_TYPE,
+                                      ChessPiece::ROOK_TYPE, ChessPiece::QUEEN_TYPE};
+         return types[(data >> 12) & 3];
+     }
+ 
+     /**
+      * @brief Checks whether this is the empty move.
+      * @return True if the move was default-constructed.
+      */
+     bool isNull() const { return data == 0; }
+ 
+     /**
+      * @brief Gets the packed 16-bit form of the move, for compact storage.
+      * @return The packed move.
+      */
+     unsigned short getData() const { return data; }
+ 
+     /**
+      * @brief Rebuilds a move from its packed form.
+      * @param packed A value returned by getData.
+      * @return The move.
+      */
+     static Move fromData(unsigned short packed) {
+         Move move;
+         move.data = packed;
+         return move;
+     }
+ 
+     /**
+      * @brief Compares two moves.
+      * @param other The move to compare with.
+      * @return True if both moves are identical.
+      */
+     bool operator==(const Move& other) const { return data == other.data; }
+ 
+     /**
+      * @brief Compares two moves.
+      * @param other The move to compare with.
+      * @return True if the moves differ.
+      */
+     bool operator!=(const Move& other) const { return data != other.data; }
+ 
+     /**
+      * @brief Formats the move in coordinate notation (e.g., "e2e4", "e7e8q").
+      * @return The move as a string.
+      */
+     string toString() const {
+         string text = squareName(getFrom()) + squareName(getTo());
+         if (getKind() == PROMOTION) text += "nbrq"[(data >> 12) & 3];
+         return text;
+     }
+ };
+ 
+ const int MAX_MOVES = 256; ///< Upper bound on the number of moves in any position.
+ 
+ /**
+  * @brief A fixed-capacity list of moves that needs no heap allocation.
+  */
+ class MoveList {
+ private:
+     Move moves[MAX_MOVES]; ///< Storage for the moves.
+     int count;             ///< Number of moves stored.
+ 
+ public:
+     /**
+      * @brief Constructs an empty MoveList.
+      */
+     MoveList() : count(0) {}
+ 
+     /**
+      * @brief Appends a move.
+      * @param move The move to add.
+      */
+     void add(const Move& move) { moves[count++] = move; }
+ 
+     /**
+      * @brief Removes all moves.
+      */
+     void clear() { count = 0; }
+ 
+     /**
+      * @brief Shrinks the list to its first n moves.
+      * @param n The new size.
+      */
+     void resize(int n) { count = n; }
+ 
+     /**
+      * @brief Gets the number of moves.
+      * @return The move count.
+      */
+     int size() const { return count; }
+ 
+     /**
+      * @brief Checks whether a move is in the list.
+      * @param move The move to look for.
+      * @return True if the list contains the move.
+      */
+     bool contains(const Move& move) const {
+         for (int i = 0; i < count; i++) {
+             if (moves[i] == move) return true;
+         }
+         return false;
+     }
+ 
+     /**
+      * @brief Accesses a move by index.
+      * @param i The index.
+      * @return Reference to the move.
+      */
+     Move& operator[](int i) { return moves[i]; }
+ 
+     /**
+      * @brief Accesses a move by index.
+      * @param i The index.
+      * @return Const reference to the move.
+      */
+     const Move& operator[](int i) const { return moves[i]; }
+ };
+ 
+ /**
+  * @brief Records the position keys of a game and how often each has occurred.
+  *
+  * Every entry stores the key together with its occurrence count, worked out when the
+  * position is recorded by looking back, two plies at a time, only over the plies since the
+  * last capture or pawn move (no earlier position can recur) and stopping at the previous
+  * occurrence. The threefold query is then a single lookup, and memory grows by one small
+  * entry per ply with no upper limit.
+  */
+ class RepetitionHistory {
+ private:
+     /**
+      * @brief One recorded position.
+      */
+     struct Entry {
+         HashKey key; ///< Zobrist key of the position.
+         int count;   ///< Occurrences of this key up to and including this ply.
+     };
+ 
+     vector<Entry> entries; ///< One entry per recorded position, oldest first.
+ 
+ public:
+     /**
+      * @brief Constructs an empty history.
+      */
+     RepetitionHistory() { entries.reserve(256); }
+ 
+     /**
+      * @brief Records a position.
+      * @param key The Zobrist key of the position.
+      * @param reversiblePlies Plies since the last capture or pawn move (the halfmove clock).
+      */
+     void push(HashKey key, int reversiblePlies) {
+         Entry entry = {key, 1};
+         int last = (int)entries.size() - 1;
+         int oldest = last - reversiblePlies + 1;
+         if (oldest < 0) oldest = 0;
+         for (int i = last - 1; i >= oldest; i -= 2) {
+             if (entries[i].key == key) {
+                 entry.count = entries[i].count + 1;
+                 break;
+             }
+         }
+         entries.push_back(entry);
+     }
+ 
+     /**
+      * @brief Removes the most recently recorded position.
+      */
+     void pop() {
+         if (!entries.empty()) entries.pop_back();
+     }
+ 
+     /**
+      * @brief Clears the history.
+      */
+     void clear() { entries.clear(); }
+ 
+     /**
+      * @brief Gets how many times the latest position has occurred.
+      * @return The occurrence count, or 0 if nothing is recorded.
+      */
+     int currentCount() const { return entries.empty() ? 0 : entries.back().count; }
+ 
+     /**
+      * @brief Gets the number of recorded positions.
+      * @return The number of entries.
+      */
+     int size() const { return (int)entries.size(); }
+ };
+ 
+ const int MATERIAL_MIDDLEGAME[6] = {82, 477, 337, 365, 1025, 0}; ///< Middlegame piece values (PeSTO), by piece type.
+ const int MATERIAL_ENDGAME[6] = {94, 512, 281, 297, 936, 0};     ///< Endgame piece values (PeSTO), by piece type.
+ const int PHASE_WEIGHT[6] = {0, 2, 1, 1, 4, 0};                  ///< Contribution of each piece type to the game phase.
+ const int PHASE_MAX = 24;                                        ///< Game phase with all pieces on the board.
+ const int SEE_VALUE[6] = {100, 500, 320, 330, 900, 20000};       ///< Piece values for static exchange evaluation.
+ 
+ /**
+  * @brief Middlegame piece-square bonuses (PeSTO), by piece type and square from White's side (a8 = 0).
+  */
+ const int PST_MIDDLEGAME[6][64] = {
+     {   // Pawn
+            0,    0,    0,    0,    0,    0,    0,    0,
+           98,  134,   61,   95,   68,  126,   34,  -11,
+           -6,    7,   26,   31,   65,   56,   25,  -20,
+          -14,   13,    6,   21,   23,   12,   17,  -23,
+          -27,   -2,   -5,   12,   17,    6,   10,  -25,
+          -26,   -4,   -4,  -10,    3,    3,   33,  -12,
+          -35,   -1,  -20,  -23,  -15,   24,   38,  -22,
+            0,    0,    0,    0,    0,    0,    0,    0
+     },
+     {   // Rook
+           32,   42,   32,   51,   63,    9,   31,   43,
+           27,   32,   58,   62,   80,   67,   26,   44,
+           -5,   19,   26,   36,   17,   45,   61,   16,
+          -24,  -11,    7,   26,   24,   35,   -8,  -20,
+          -36,  -26,  -12,   -1,    9,   -7,    6,  -23,
+          -45,  -25,  -16,  -17,    3,    0,   -5,  -33,
+          -44,  -16,  -20,   -9,   -1,   11,   -6,  -71,
+          -19,  -13,    1,   17,   16,    7,  -37,  -26
+     },
+     {   // Knight
+         -167,  -89,  -34,  -49,   61,  -97,  -15, -107,
+          -73,  -41,   72,   36,   23,   62,    7,  -17,
+          -47,   60,   37,   65,   84,  129,   73,   44,
+           -9,   17,   19,   53,   37,   69,   18,   22,
+          -13,    4,   16,   13,   28,   19,   21,   -8,
+          -23,   -9,   12,   10,   19,   17,   25,  -16,
+          -29,  -53,  -12,   -3,   -1,   18,  -14,  -19,
+         -105,  -21,  -58,  -33,  -17,  -28,  -19,  -23
+     },
+     {   // Bishop
+          -29,    4,  -82,  -37,  -25,  -42,    7,   -8,
+          -26,   16,  -18,  -13,   30,   59,   18,  -47,
+          -16,   37,   43,   40,   35,   50,   37,   -2,
+           -4,    5,   19,   50,   37,   37,    7,   -2,
+           -6,   13,   13,   26,   34,   12,   10,    4,
+            0,   15,   15,   15,   14,   27,   18,   10,
+            4,   15,   16,    0,    7,   21,   33,    1,
+          -33,   -3,  -14,  -21,  -13,  -12,  -39,  -21
+     },
+     {   // Queen
+          -28,    0,   29,   12,   59,   44,   43,   45,
+          -24,  -39,   -5,    1,  -16,   57,   28,   54,
+          -13,  -17,    7,    8,   29,   56,   47,   57,
+          -27,  -27,  -16,  -16,   -1,   17,   -2,    1,
+           -9,  -26,   -9,  -10,   -2,   -4,    3,   -3,
+          -14,    2,  -11,   -2,   -5,    2,   14,    5,
+          -35,   -8,   11,    2,    8,   15,   -3,    1,
+           -1,  -18,   -9,   10,  -15,  -25,  -31,  -50
+     },
+     {   // King
+          -65,   23,   16,  -15,  -56,  -34,    2,   13,
+           29,   -1,  -20,   -7,   -8,   -4,  -38,  -29,
+           -9,   24,    2,  -16,  -20,    6,   22,  -22,
+          -17,  -20,  -12,  -27,  -30,  -25,  -14,  -36,
+          -49,   -1,  -27,  -39,  -46,  -44,  -33,  -51,
+          -14,  -14,  -22,  -46,  -44,  -30,  -15,  -27,
+            1,    7,   -8,  -64,  -43,  -16,    9,    8,
+          -15,   36,   12,  -54,    8,  -28,   24,   14
+     }
+ };
+ 
+ /**
+  * @brief Endgame piece-square bonuses (PeSTO), by piece type and square from White's side (a8 = 0).
+  */
+ const int PST_ENDGAME[6][64] = {
+     {   // Pawn
+            0,    0,    0,    0,    0,    0,    0,    0,
+          178,  173,  158,  134,  147,  132,  165,  187,
+           94,  100,   85,   67,   56,   53,   82,   84,
+           32,   24,   13,    5,   -2,    4,   17,   17,
+           13,    9,   -3,   -7,   -7,   -8,    3,   -1,
+            4,    7,   -6,    1,    0,   -5,   -1,   -8,
+           13,    8,    8,   10,   13,    0,    2,   -7,
+            0,    0,    0,    0,    0,    0,    0,    0
+     },
+     {   // Rook
+           13,   10,   18,   15,   12,   12,    8,    5,
+           11,   13,   13,   11,   -3,    3,    8,    3,
+            7,    7,    7,    5,    4,   -3,   -5,   -3,
+            4,    3,   13,    1,    2,    1,   -1,    2,
+            3,    5,    8,    4,   -5,   -6,   -8,  -11,
+           -4,    0,   -5,   -1,   -7,  -12,   -8,  -16,
+           -6,   -6,    0,    2,   -9,   -9,  -11,   -3,
+           -9,    2,    3,   -1,   -5,  -13,    4,  -20
+     },
+     {   // Knight
+          -58,  -38,  -13,  -28,  -31,  -27,  -63,  -99,
+          -25,   -8,  -25,   -2,   -9,  -25,  -24,  -52,
+          -24,  -20,   10,    9,   -1,   -9,  -19,  -41,
+          -17,    3,   22,   22,   22,   11,    8,  -18,
+          -18,   -6,   16,   25,   16,   17,    4,  -18,
+          -23,   -3,   -1,   15,   10,   -3,  -20,  -22,
+          -42,  -20,  -10,   -5,   -2,  -20,  -23,  -44,
+          -29,  -51,  -23,  -15,  -22,  -18,  -50,  -64
+     },
+     {   // Bishop
+          -14,  -21,  -11,   -8,   -7,   -9,  -17,  -24,
+           -8,   -4,    7,  -12,   -3,  -13,   -4,  -14,
+            2,   -8,    0,   -1,   -2,    6,    0,    4,
+           -3,    9,   12,    9,   14,   10,    3,    2,
+           -6,    3,   13,   19,    7,   10,   -3,   -9,
+          -12,   -3,    8,   10,   13,    3,   -7,  -15,
+          -14,  -18,   -7,   -1,    4,   -9,  -15,  -27,
+          -23,   -9,  -23,   -5,   -9,  -16,   -5,  -17
+     },
+     {   // Queen
+           -9,   22,   22,   27,   27,   19,   10,   20,
+          -17,   20,   32,   41,   58,   25,   30,    0,
+          -20,    6,    9,   49,   47,   35,   19,    9,
+            3,   22,   24,   45,   57,   40,   57,   36,
+          -18,   28,   19,   47,   31,   34,   39,   23,
+          -16,  -27,   15,    6,    9,   17,   10,    5,
+          -22,  -23,  -30,  -16,  -16,  -23,  -36,  -32,
+          -33,  -28,  -22,  -43,   -5,  -32,  -20,  -41
+     },
+     {   // King
+          -74,  -35,  -18,  -18,  -11,   15,    4,  -17,
+          -12,   17,   14,   17,   17,   38,   23,   11,
+           10,   17,   23,   15,   20,   45,   44,   13,
+           -8,   22,   24,   27,   26,   33,   26,    3,
+          -18,   -4,   21,   24,   27,   23,    9,  -11,
+          -19,   -3,   11,   21,   23,   16,    7,   -9,
+          -27,  -11,    4,   13,   14,    4,   -5,  -17,
+          -53,  -34,  -21,  -11,  -28,  -14,  -24,  -43
+     }
+ };
+ 
+ /**
+  * @brief Combined material and piece-square scores for every piece on every square.
+  *
+  * Black's entries mirror White's vertically and are negated, so a position's score is the
+  * plain sum over its pieces, positive when White stands better.
+  */
+ struct PieceSquareScores {
+     int middlegame[2][6][64]; ///< Middlegame score by color, piece type and square.
+     int endgame[2][6][64];    ///< Endgame score by color, piece type and square.
+ 
+     constexpr PieceSquareScores() : middlegame(), endgame() {
+         for (int type = 0; type < 6; type++) {
+             for (int sq = 0; sq < 64; sq++) {
+                 middlegame[COLOR_WHITE][type][sq] = MATERIAL_MIDDLEGAME[type] + PST_MIDDLEGAME[type][sq];
+                 endgame[COLOR_WHITE][type][sq] = MATERIAL_ENDGAME[type] + PST_ENDGAME[type][sq];
+                 middlegame[COLOR_BLACK][type][sq] = -(MATERIAL_MIDDLEGAME[type] + PST_MIDDLEGAME[type][sq ^ 56]);
+                 endgame[COLOR_BLACK][type][sq] = -(MATERIAL_ENDGAME[type] + PST_ENDGAME[type][sq ^ 56]);
+             }
+         }
+     }
+ };
+ 
+ constexpr PieceSquareScores PIECE_SQUARE_SCORES; ///< The precomputed evaluation terms.
+ 
+ const int NNUE_FEATURES = 768;   ///< Inputs per perspective: 2 relative colors x 6 piece types x 64 squares.
+ const int NNUE_HIDDEN = 256;     ///< Accumulator width per perspective.
+ const int NNUE_QA = 255;         ///< Quantization of the first layer (activations are clamped to [0, QA]).
+ const int NNUE_QB = 64;          ///< Quantization of the output weights.
+ const int NNUE_SCALE = 400;      ///< Converts the network output to centipawns.
+ const int NNUE_MAX_SCORE = 20000; ///< Output clamp, well clear of the search's mate scores.
+ 
+ /**
+  * @brief Adds one feature's first-layer weights to an accumulator.
+  * @param acc The accumulator (NNUE_HIDDEN values, 32-byte aligned).
+  * @param weights The feature's weights (NNUE_HIDDEN values, 32-byte aligned).
+  */
+ inline void nnueAddFeature(short* acc, const short* weights) {
+ #if defined(__AVX2__)
+     for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+         __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+         _mm256_store_si256((__m256i*)(acc + i), _mm256_add_epi16(a, _mm256_load_si256((const __m256i*)(weights + i))));
+     }
+ #elif defined(__SSE4_1__)
+     for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+         __m128i a = _mm_load_si128((const __m128i*)(acc + i));
+         _mm_store_si128((__m128i*)(acc + i), _mm_add_epi16(a, _mm_load_si128((const __m128i*)(weights + i))));
+     }
+ #else
+     for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] = (short)(acc[i] + weights[i]);
+ #endif
+ }
+ 
+ /**
+  * @brief Subtracts one feature's first-layer weights from an accumulator.
+  * @param acc The accumulator (NNUE_HIDDEN values, 32-byte aligned).
+  * @param weights The feature's weights (NNUE_HIDDEN values, 32-byte aligned).
+  */
+ inline void nnueSubFeature(short* acc, const short* weights) {
+ #if defined(__AVX2__)
+     for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+         __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+         _mm256_store_si256((__m256i*)(acc + i), _mm256_sub_epi16(a, _mm256_load_si256((const __m256i*)(weights + i))));
+     }
+ #elif defined(__SSE4_1__)
+     for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+         __m128i a = _mm_load_si128((const __m128i*)(acc + i));
+         _mm_store_si128((__m128i*)(acc + i), _mm_sub_epi16(a, _mm_load_si128((const __m128i*)(weights + i))));
+     }
+ #else
+     for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] = (short)(acc[i] - weights[i]);
+ #endif
+ }
+ 
+ /**
+  * @brief Dot product of a clipped-ReLU activated accumulator with output weights.
+  * @param acc The accumulator (NNUE_HIDDEN values, 32-byte aligned).
+  * @param weights The output weights for that half (NNUE_HIDDEN values, 32-byte aligned).
+  * @return The sum of clamp(acc[i], 0, QA) * weights[i].
+  */
+ inline int nnueClippedDot(const short* acc, const short* weights) {
+ #if defined(__AVX2__)
+     const __m256i zero = _mm256_setzero_si256();
+     const __m256i ceiling = _mm256_set1_epi16(NNUE_QA);
+     __m256i sum = _mm256_setzero_si256();
+     for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+         __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+         a = _mm256_min_epi16(_mm256_max_epi16(a, zero), ceiling);
+         sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, _mm256_load_si256((const __m256i*)(weights + i))));
+     }
+     __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+     half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+     half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+     return _mm_cvtsi128_si32(half);
+ #elif defined(__SSE4_1__)
+     const __m128i zero = _mm_setzero_si128();
+     const __m128i ceiling = _mm_set1_epi16(NNUE_QA);
+     __m128i sum = _mm_setzero_si128();
+     for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+         __m128i a = _mm_load_si128((const __m128i*)(acc + i));
+         a = _mm_min_epi16(_mm_max_epi16(a, zero), ceiling);
+         sum = _mm_add_epi32(sum, _mm_madd_epi16(a, _mm_load_si128((const __m128i*)(weights + i))));
+     }
+     sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+     sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+     return _mm_cvtsi128_si32(sum);
+ #else
+     int sum = 0;
+     for (int i = 0; i < NNUE_HIDDEN; i++) {
+         int a = acc[i] < 0 ? 0 : acc[i] > NNUE_QA ? NNUE_QA : acc[i];
+         sum += a * weights[i];
+     }
+     return sum;
+ #endif
+ }
+ 
+ /**
+  * @brief Weights of a small efficiently updatable network: 768 inputs per perspective,
+  *        a NNUE_HIDDEN-wide accumulator per perspective, and one output.
+  *
+  * Each side's accumulator sums the first-layer columns of the pieces on the board as that
+  * side sees them (own pieces first, board mirrored for Black), so a move only adds and
+  * subtracts a few columns. The output is a clipped-ReLU dot product over the side to
+  * move's accumulator followed by the opponent's.
+  *
+  * Weight file (little-endian): "LCNN", uint32 version (1), uint32 hidden size (NNUE_HIDDEN),
+  * int16 feature weights [768][NNUE_HIDDEN], int16 feature biases [NNUE_HIDDEN], int16 output
+  * weights [2 * NNUE_HIDDEN] (side to move first), int32 output bias. Feature index is
+  * relative color * 384 + piece type * 64 + square, with this program's piece type order
+  * and squares numbered from a8 = 0 on the perspective's side of the board.
+  */
+ class NnueNetwork {
+ private:
+     alignas(32) short featureWeights[NNUE_FEATURES][NNUE_HIDDEN]; ///< First-layer weight column per feature.
+     alignas(32) short featureBias[NNUE_HIDDEN];                   ///< First-layer biases.
+     alignas(32) short outputWeights[2 * NNUE_HIDDEN];             ///< Output weights, side to move half first.
+     int outputBias;                                               ///< Output bias.
+ 
+     static const NnueNetwork* active; ///< The network used by every board (nullptr if none).
+ 
+ public:
+     /**
+      * @brief Loads a network from a weight file and makes it active for boards created afterwards.
+      * @param path The file to read.
+      * @return True if the file was read and matches this program's layout.
+      */
+     static bool load(const string& path) {
+         ifstream in(path.c_str(), ios::binary);
+         char magic[4];
+         unsigned version = 0, hidden = 0;
+         if (!in.read(magic, 4) || string(magic, 4) != "LCNN") return false;
+         if (!in.read((char*)&version, 4) || !in.read((char*)&hidden, 4)) return false;
+         if (version != 1 || hidden != (unsigned)NNUE_HIDDEN) return false;
+         NnueNetwork* network = new NnueNetwork();
+         in.read((char*)network->featureWeights, sizeof(network->featureWeights));
+         in.read((char*)network->featureBias, sizeof(network->featureBias));
+         in.read((char*)network->outputWeights, sizeof(network->outputWeights));
+         in.read((char*)&network->outputBias, sizeof(network->outputBias));
+         if (!in) {
+             delete network;
+             return false;
+         }
+         delete active;
+         active = network;
+         return true;
+     }
+ 
+     /**
+      * @brief Gets the active network.
+      * @return The network, or nullptr if none has been loaded.
+      */
+     static const NnueNetwork* get() { return active; }
+ 
+     /**
+      * @brief Gets the first-layer weights of the feature for a piece as one side sees it.
+      * @param perspective The color whose accumulator is updated.
+      * @param color The piece's color.
+      * @param type The piece's type.
+      * @param sq The piece's square.
+      * @return NNUE_HIDDEN weights.
+      */
+     const short* feature(int perspective, int color, int type, int sq) const {
+         int relativeSq = perspective == COLOR_WHITE ? sq : sq ^ 56;
+         return featureWeights[(color != perspective) * 384 + type * 64 + relativeSq];
+     }
+ 
+     /**
+      * @brief Gets the first-layer biases, the accumulator of an empty board.
+      * @return NNUE_HIDDEN biases.
+      */
+     const short* bias() const { return featureBias; }
+ 
+     /**
+      * @brief Runs the output layer.
+      * @param us The side to move's accumulator.
+      * @param them The opponent's accumulator.
+      * @return The score in centipawns from the side to move's point of view, clamped to NNUE_MAX_SCORE.
+      */
+     int evaluate(const short* us, const short* them) const {
+         long long sum = (long long)outputBias + nnueClippedDot(us, outputWeights)
+                       + nnueClippedDot(them, outputWeights + NNUE_HIDDEN);
+         long long score = sum * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+         return (int)max<long long>(-NNUE_MAX_SCORE, min<long long>(NNUE_MAX_SCORE, score));
+     }
+ };
+ 
+ const NnueNetwork* NnueNetwork::active = nullptr;
+ 
+ /**
+  * @brief Represents the chessboard and manages game state.
+  */
+ class ChessBoard : public Displayable {
+ private:
+     Square squares[8][8];                ///< 8x8 grid of squares.
+     Bitboard pieceBB[2][6];              ///< One bitboard per color and piece type.
+     Bitboard colorBB[2];                 ///< Occupancy of each color.
+     Bitboard occupiedBB;                 ///< Occupancy of both colors.
+     int kingSquare[2];                   ///< Square of each color's king (-1 if it has none).
+     int middlegameScore;                 ///< Sum of middlegame material and piece-square scores (White positive).
+     int endgameScore;                    ///< Sum of endgame material and piece-square scores (White positive).
+     int gamePhase;                       ///< Sum of PHASE_WEIGHT over the pieces on the board.
+     const NnueNetwork* network;          ///< Network whose accumulators are kept (nullptr for PeSTO only).
+     alignas(32) short accumulator[2][NNUE_HIDDEN]; ///< First-layer sums from each color's perspective.
+     int sideToMove;                      ///< Color index of the side to move.
+     int castlingRights;                  ///< Remaining castling rights (CASTLE_* flags).
+     HashKey positionKey;                 ///< Zobrist key of the current position.
+     int lastMoveFromX, lastMoveFromY;    ///< Coordinates of the last move's starting position.
+     int lastMoveToX, lastMoveToY;        ///< Coordinates of the last move's ending position.
+     bool lastMoveWasPawnTwoSquares;      ///< Tracks if the last move was a pawn double move (for en passant).
+     int halfMoveClock;                   ///< Counter for the 50-move draw rule.
+     int fullMoveNumber;                  ///< Move number, incremented after each black move.
+     RepetitionHistory positionHistory;   ///< Position keys played so far, for threefold repetition.
+ 
+     /**
+      * @brief Everything doMove changes that cannot be recomputed when the move is taken back.
+      */
+     struct UndoRecord {
+         Move move;                  ///< The move that was made.
+         PieceCode captured;         ///< The captured piece (NO_PIECE if none).
+         HashKey positionKey;        ///< Position key before the move.
+         short halfMoveClock;        ///< Halfmove clock before the move.
+         signed char castlingRights; ///< Castling rights before the move.
+         signed char lastMoveFrom;   ///< Starting square of the previous move (-1 if none).
+         signed char lastMoveTo;     ///< Ending square of the previous move (-1 if none).
+         bool lastMoveWasPawnTwoSquares; ///< En passant flag before the move.
+     };
+ 
+     vector<UndoRecord> undoStack;        ///< One record per move made with doMove.
+ 
+     /**
+      * @brief What a side's king is exposed to, computed once per position for move legality.
+      */
+     struct CheckInfo {
+         Bitboard checkers;    ///< Enemy pieces giving check.
+         Bitboard pinned;      ///< Own pieces pinned to the king.
+         Bitboard evasionMask; ///< Squares a non-king move must land on (all squares when not in check).
+     };
+ 
+     /**
+      * @brief Sets both accumulators to the network's biases, as for an empty board.
+      */
+     void resetAccumulators() {
+         if (!network) return;
+         for (int i = 0; i < NNUE_HIDDEN; i++) {
+             accumulator[COLOR_WHITE][i] = accumulator[COLOR_BLACK][i] = network->bias()[i];
+         }
+     }
+ 
+     /**
+      * @brief Adds a pawn move, expanding it into the four promotions on the last rank.
+      * @param from The starting square index.
+      * @param to The ending square index.
+      * @param promotes True if the pawn reaches the last rank.
+      * @param list The list to append to.
+      */
+     static void addPawnMove(int from, int to, bool promotes, MoveList& list) {
+         if (!promotes) {
+             list.add(Move(from / 8, from % 8, to / 8, to % 8));
+             return;
+         }
+         list.add(Move(from / 8, from % 8, to / 8, to % 8, Move::PROMOTION, ChessPiece::QUEEN_TYPE));
+         list.add(Move(from / 8, from % 8, to / 8, to % 8, Move::PROMOTION, ChessPiece::ROOK_TYPE));
+         list.add(Move(from / 8, from % 8, to / 8, to % 8, Move::PROMOTION, ChessPiece::BISHOP_TYPE));
+         list.add(Move(from / 8, from % 8, to / 8, to % 8, Move::PROMOTION, ChessPiece::KNIGHT_TYPE));
+     }
+ 
+     /**
+      * @brief Computes the squares a non-pawn piece attacks.
+      * @param type The piece type.
+      * @param sq The piece's square.
+      * @param occupied The occupancy used for sliding pieces.
+      * @return Bitboard of attacked squares.
+      */
+     static Bitboard pieceAttacks(int type, int sq, Bitboard occupied) {
+         switch (type) {
+             case ChessPiece::KNIGHT_TYPE: return knightAttacks(sq);
+             case ChessPiece::BISHOP_TYPE: return bishopAttacks(sq, occupied);
+             case ChessPiece::ROOK_TYPE: return rookAttacks(sq, occupied);
+             case ChessPiece::QUEEN_TYPE: return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+             case ChessPiece::KING_TYPE: return kingAttacks(sq);
+         }
+         return 0;
+     }
+ 
+ public:
+     /**
+      * @brief Constructs an empty ChessBoard.
+      *
+      * Boards hold only plain values, so they can be freely copied (e.g., one per thread).
+      */
+     ChessBoard() : sideToMove(COLOR_WHITE), castlingRights(0), positionKey(ZOBRIST.castling[0]),
+                    lastMoveFromX(-1), lastMoveFromY(-1), lastMoveToX(-1), lastMoveToY(-1),
+                    lastMoveWasPawnTwoSquares(false), halfMoveClock(0), fullMoveNumber(1) {
+         for (int c = 0; c < 2; c++) {
+             for (int t = 0; t < 6; t++) pieceBB[c][t] = 0;
+             colorBB[c] = 0;
+         }
+         occupiedBB = 0;
+         kingSquare[COLOR_WHITE] = kingSquare[COLOR_BLACK] = -1;
+         middlegameScore = endgameScore = gamePhase = 0;
+         network = NnueNetwork::get();
+         resetAccumulators();
+         undoStack.reserve(256);
+     }
+ 
+     /**
+      * @brief Removes every piece and resets all game state to an empty board.
+      */
+     void clear() {
+         for (int i = 0; i < 8; i++) {
+             for (int j = 0; j < 8; j++) squares[i][j].setPiece(NO_PIECE);
+         }
+         undoStack.clear();
+         for (int c = 0; c < 2; c++) {
+             for (int t = 0; t < 6; t++) pieceBB[c][t] = 0;
+             colorBB[c] = 0;
+         }
+         occupiedBB = 0;
+         kingSquare[COLOR_WHITE] = kingSquare[COLOR_BLACK] = -1;
+         middlegameScore = endgameScore = gamePhase = 0;
+         resetAccumulators();
+         sideToMove = COLOR_WHITE;
+         castlingRights = 0;
+         positionKey = ZOBRIST.castling[0];
+         lastMoveFromX = lastMoveFromY = lastMoveToX = lastMoveToY = -1;
+         lastMoveWasPawnTwoSquares = false;
+         halfMoveClock = 0;
+         fullMoveNumber = 1;
+         positionHistory.clear();
+     }
+ 
+     /**
+      * @brief Sets up a position from Forsyth-Edwards Notation.
+      *
+      * Reads piece placement, side to move, castling rights, the en passant square and the
+      * halfmove and fullmove counters. The board is left untouched if the text cannot be
+      * parsed, has text after the counters, does not have exactly one king per side, has a
+      * pawn on the first or last rank, or leaves the side that just moved in check.
+      * @param fen The position in FEN (the counter fields are optional).
+      * @return True if the position was loaded, false if the FEN is malformed.
+      */
+     bool loadFEN(const string& fen) {
+         istringstream in(fen);
+         string placement, side, castling = "-", enPassant = "-";
+         int halfMoves = 0, fullMoves = 1;
+         if (!(in >> placement >> side)) return false;
+         in >> castling >> enPassant;
+         string counter;
+         for (int field = 0; in >> counter; field++) {
+             // Only the two counters may follow, and nothing after them.
+             if (field > 1 || counter.find_first_not_of("0123456789") != string::npos) return false;
+             (field == 0 ? halfMoves : fullMoves) = atoi(counter.c_str());
+         }
+         if (fullMoves < 1) fullMoves = 1;
+ 
+         // Every rank must be closed by '/' (or the end) after exactly eight files.
+         int codes[64];
+         int rank = 0, file = 0;
+         for (size_t i = 0; i < placement.size(); i++) {
+             char ch = placement[i];
+             if (ch == '/') {
+                 if (file != 8 || ++rank > 7) return false;
+                 file = 0;
+             } else if (ch >= '1' && ch <= '8') {
+                 if (file + (ch - '0') > 8) return false;
+                 for (int k = 0; k < ch - '0'; k++) codes[rank * 8 + file++] = -1;
+             } else {
+                 size_t type = string("prnbqk").find(ch >= 'a' ? ch : char(ch + 32));
+                 if (type == string::npos || file >= 8) return false;
+                 static const int TYPES[6] = {ChessPiece::PAWN_TYPE, ChessPiece::ROOK_TYPE, ChessPiece::KNIGHT_TYPE,
+                                              ChessPiece::BISHOP_TYPE, ChessPiece::QUEEN_TYPE, ChessPiece::KING_TYPE};
+                 codes[rank * 8 + file++] = TYPES[type] * 2 + (ch >= 'a' ? COLOR_BLACK : COLOR_WHITE);
+             }
+         }
+         if (rank != 7 || file != 8 || (side != "w" && side != "b")) return false;
+         int kings[2] = {0, 0};
+         for (int i = 0; i < 64; i++) {
+             if (codes[i] >= 0 && codes[i] / 2 == ChessPiece::KING_TYPE) kings[codes[i] % 2]++;
+             if (codes[i] >= 0 && codes[i] / 2 == ChessPiece::PAWN_TYPE && (i < 8 || i >= 56)) return false;
+         }
+         if (kings[COLOR_WHITE] != 1 || kings[COLOR_BLACK] != 1) return false;
+ 
+         // The side that just moved cannot have left its own king in check.
+         int mover = (side == "w") ? COLOR_BLACK : COLOR_WHITE;
+         Bitboard occupied = 0, attackers[6] = {0, 0, 0, 0, 0, 0};
+         int target = -1;
+         for (int i = 0; i < 64; i++) {
+             if (codes[i] < 0) continue;
+             occupied |= squareBit(i);
+             if (codes[i] % 2 != mover) attackers[codes[i] / 2] |= squareBit(i);
+             else if (codes[i] / 2 == ChessPiece::KING_TYPE) target = i;
+         }
+         Bitboard rooksQueens = attackers[ChessPiece::ROOK_TYPE] | attackers[ChessPiece::QUEEN_TYPE];
+         Bitboard bishopsQueens = attackers[ChessPiece::BISHOP_TYPE] | attackers[ChessPiece::QUEEN_TYPE];
+         if ((pawnAttacks(mover, target) & attackers[ChessPiece::PAWN_TYPE])
+             | (knightAttacks(target) & attackers[ChessPiece::KNIGHT_TYPE])
+             | (kingAttacks(target) & attackers[ChessPiece::KING_TYPE])
+             | (rookAttacks(target, occupied) & rooksQueens) | (bishopAttacks(target, occupied) & bishopsQueens))
+             return false;
+         Position epPos = (enPassant == "-") ? Position(-1, -1) : algebraicToIndices(enPassant);
+         if (enPassant != "-" && epPos.getRow() != (side == "w" ? 2 : 5)) return false;
+ 
+         clear();
+         for (int i = 0; i < 64; i++) {
+             if (codes[i] < 0) continue;
+             setPieceAt(i / 8, i % 8, makePiece(codes[i] % 2, codes[i] / 2));
+         }
+         // Keep only the rights whose king and rook still stand on their home squares.
+         int king = ChessPiece::KING_TYPE * 2, rook = ChessPiece::ROOK_TYPE * 2;
+         if (castling.find('K') != string::npos && codes[60] == king && codes[63] == rook)
+             castlingRights |= CASTLE_WHITE_KINGSIDE;
+         if (castling.find('Q') != string::npos && codes[60] == king && codes[56] == rook)
+             castlingRights |= CASTLE_WHITE_QUEENSIDE;
+         if (castling.find('k') != string::npos && codes[4] == king + 1 && codes[7] == rook + 1)
+             castlingRights |= CASTLE_BLACK_KINGSIDE;
+         if (castling.find('q') != string::npos && codes[4] == king + 1 && codes[0] == rook + 1)
+             castlingRights |= CASTLE_BLACK_QUEENSIDE;
+         if (side == "b") sideToMove = COLOR_BLACK;
+         // Drop an en passant square unless an enemy pawn has just double-pushed past it.
+         if (epPos.getRow() != -1) {
+             int dir = (side == "w") ? 1 : -1;
+             int pawn = ChessPiece::PAWN_TYPE * 2 + (side == "w" ? COLOR_BLACK : COLOR_WHITE);
+             int target = epPos.getRow() * 8 + epPos.getCol();
+             if (codes[target + dir * 8] != pawn || codes[target] >= 0 || codes[target - dir * 8] >= 0)
+                 epPos = Position(-1, -1);
+         }
+         if (epPos.getRow() != -1) {
+             int pawnFromX = (side == "w") ? 1 : 6;
+             int pawnToX = (side == "w") ? 3 : 4;
+             lastMoveFromX = pawnFromX;
+             lastMoveToX = pawnToX;
+             lastMoveFromY = lastMoveToY = epPos.getCol();
+             lastMoveWasPawnTwoSquares = true;
+         }
+         halfMoveClock = halfMoves;
+         fullMoveNumber = fullMoves;
+         positionKey = computePositionKey();
+         positionHistory.push(positionKey, halfMoveClock);
+         return true;
+     }
+ 
+     /**
+      * @brief Describes the current position in Forsyth-Edwards Notation.
+      * @return The position as a FEN string with all six fields.
+      */
+     string toFEN() const {
+         static const char LETTERS[6] = {'p', 'r', 'n', 'b', 'q', 'k'};
+         string fen;
+         for (int i = 0; i < 8; i++) {
+             int empty = 0;
+             for (int j = 0; j < 8; j++) {
+                 PieceCode piece = squares[i][j].getPiece();
+                 if (piece == NO_PIECE) {
+                     empty++;
+                     continue;
+                 }
+                 if (empty) fen += char('0' + empty);
+                 empty = 0;
+                 char letter = LETTERS[pieceType(piece)];
+                 fen += (pieceColor(piece) == COLOR_WHITE) ? char(letter - 32) : letter;
+             }
+             if (empty) fen += char('0' + empty);
+             if (i < 7) fen += '/';
+         }
+         fen += (sideToMove == COLOR_WHITE) ? " w " : " b ";
+         if (castlingRights & CASTLE_WHITE_KINGSIDE) fen += 'K';
+         if (castlingRights & CASTLE_WHITE_QUEENSIDE) fen += 'Q';
+         if (castlingRights & CASTLE_BLACK_KINGSIDE) fen += 'k';
+         if (castlingRights & CASTLE_BLACK_QUEENSIDE) fen += 'q';
+         if (!castlingRights) fen += '-';
+         fen += ' ';
+         int enPassantSq = getEnPassantSquare();
+         fen += (enPassantSq >= 0) ? squareName(enPassantSq) : "-";
+         ostringstream counters;
+         counters << ' ' << halfMoveClock << ' ' << fullMoveNumber;
+         return fen + counters.str();
+     }
+ 
+     /**
+      * @brief Initializes the board with the standard chess starting position.
+      */
+     void initializeBoard() {
+         static const int BACK_RANK[8] = {ChessPiece::ROOK_TYPE, ChessPiece::KNIGHT_TYPE, ChessPiece::BISHOP_TYPE,
+                                          ChessPiece::QUEEN_TYPE, ChessPiece::KING_TYPE, ChessPiece::BISHOP_TYPE,
+                                          ChessPiece::KNIGHT_TYPE, ChessPiece::ROOK_TYPE};
+         for (int i = 0; i < 8; i++) {
+             setPieceAt(1, i, makePiece(COLOR_BLACK, ChessPiece::PAWN_TYPE));
+             setPieceAt(6, i, makePiece(COLOR_WHITE, ChessPiece::PAWN_TYPE));
+             setPieceAt(0, i, makePiece(COLOR_BLACK, BACK_RANK[i]));
+             setPieceAt(7, i, makePiece(COLOR_WHITE, BACK_RANK[i]));
+         }
+         positionKey ^= ZOBRIST.castling[castlingRights];
+         castlingRights = CASTLE_ALL;
+         positionKey ^= ZOBRIST.castling[castlingRights];
+         positionHistory.clear();
+         positionHistory.push(positionKey, halfMoveClock);
+     }
  
      /**
       * @brief Displays the current state of the board to the console.
       */
-     void display() const {
-         cout << "  a b c d e f g h\n";
-         for (int i = 0; i < 8; i++) {
-             cout << (8 - i) << " ";
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = squares[i][j].getPiece();
-                 if (piece) piece->display();
-                 else cout << ".";
-                 cout << " ";
-             }
-             cout << (8 - i) << "\n";
-         }
-         cout << "  a b c d e f g h\n";
+     void display() const {
+         cout << "  a b c d e f g h\n";
+         for (int i = 0; i < 8; i++) {
+             cout << (8 - i) << " ";
+             for (int j = 0; j < 8; j++) {
+                 const ChessPiece* piece = getPieceAt(i, j);
+                 if (piece) piece->display();
+                 else cout << ".";
+                 cout << " ";
+             }
+             cout << (8 - i) << "\n";
+         }
+         cout << "  a b c d e f g h\n";
+     }
+ 
+     /**
+      * @brief Gets the piece at a specific position.
+      * @param x The row index.
+      * @param y The column index.
+      * @return Read-only view of the piece at (x, y), or nullptr if empty or out of bounds.
+      */
+     const ChessPiece* getPieceAt(int x, int y) const {
+         if (x < 0 || x > 7 || y < 0 || y > 7) return nullptr;
+         return PieceViews::get(squares[x][y].getPiece(), squareIndex(x, y));
+     }
+ 
+     /**
+      * @brief Gets the code of the piece at a specific position.
+      * @param sq The square index.
+      * @return The piece code, or NO_PIECE if the square is empty.
+      */
+     PieceCode getPieceCode(int sq) const { return squares[sq / 8][sq % 8].getPiece(); }
+ 
+     /**
+      * @brief Sets a piece at a specific position on the board.
+      *
+      * The bitboards, king squares, position key, evaluation terms and network accumulators
+      * are kept in sync with the squares, so this is the single entry point for changing what
+      * stands on a square.
+      * @param x The row index.
+      * @param y The column index.
+      * @param piece The piece code to place (NO_PIECE to empty the square).
+      */
+     void setPieceAt(int x, int y, PieceCode piece) {
+         if (x < 0 || x > 7 || y < 0 || y > 7) return;
+         int sq = squareIndex(x, y);
+         Bitboard bit = squareBit(sq);
+         PieceCode old = squares[x][y].getPiece();
+         if (old != NO_PIECE) {
+             pieceBB[pieceColor(old)][pieceType(old)] &= ~bit;
+             colorBB[pieceColor(old)] &= ~bit;
+             occupiedBB &= ~bit;
+             positionKey ^= ZOBRIST.piece[pieceColor(old)][pieceType(old)][sq];
+             middlegameScore -= PIECE_SQUARE_SCORES.middlegame[pieceColor(old)][pieceType(old)][sq];
+             endgameScore -= PIECE_SQUARE_SCORES.endgame[pieceColor(old)][pieceType(old)][sq];
+             gamePhase -= PHASE_WEIGHT[pieceType(old)];
+             if (network) {
+                 nnueSubFeature(accumulator[COLOR_WHITE], network->feature(COLOR_WHITE, pieceColor(old), pieceType(old), sq));
+                 nnueSubFeature(accumulator[COLOR_BLACK], network->feature(COLOR_BLACK, pieceColor(old), pieceType(old), sq));
+             }
+             if (pieceType(old) == ChessPiece::KING_TYPE && kingSquare[pieceColor(old)] == sq) {
+                 kingSquare[pieceColor(old)] = -1;
+             }
+         }
+         if (piece != NO_PIECE) {
+             pieceBB[pieceColor(piece)][pieceType(piece)] |= bit;
+             colorBB[pieceColor(piece)] |= bit;
+             occupiedBB |= bit;
+             positionKey ^= ZOBRIST.piece[pieceColor(piece)][pieceType(piece)][sq];
+             middlegameScore += PIECE_SQUARE_SCORES.middlegame[pieceColor(piece)][pieceType(piece)][sq];
+             endgameScore += PIECE_SQUARE_SCORES.endgame[pieceColor(piece)][pieceType(piece)][sq];
+             gamePhase += PHASE_WEIGHT[pieceType(piece)];
+             if (network) {
+                 nnueAddFeature(accumulator[COLOR_WHITE], network->feature(COLOR_WHITE, pieceColor(piece), pieceType(piece), sq));
+                 nnueAddFeature(accumulator[COLOR_BLACK], network->feature(COLOR_BLACK, pieceColor(piece), pieceType(piece), sq));
+             }
+             if (pieceType(piece) == ChessPiece::KING_TYPE) kingSquare[pieceColor(piece)] = sq;
+         }
+         squares[x][y].setPiece(piece);
+     }
+ 
+     /**
+      * @brief Sets a piece at a specific position on the board.
+      * @param x The row index.
+      * @param y The column index.
+      * @param piece The piece whose color and type to place (nullptr empties the square).
+      *              The board does not keep the object.
+      */
+     void setPieceAt(int x, int y, const ChessPiece* piece) {
+         setPieceAt(x, y, piece ? makePiece(piece->getColorIndex(), piece->getType()) : NO_PIECE);
+     }
+ 
+     /**
+      * @brief Gets the bitboard of one color's pieces of a given type.
+      * @param color The color index (COLOR_WHITE or COLOR_BLACK).
+      * @param type The piece type (e.g., ChessPiece::PAWN_TYPE).
+      * @return Bitboard of matching pieces.
+      */
+     Bitboard getPieceBitboard(int color, int type) const { return pieceBB[color][type]; }
+ 
+     /**
+      * @brief Gets the bitboard of all pieces of one color.
+      * @param color The color index (COLOR_WHITE or COLOR_BLACK).
+      * @return Bitboard of that color's pieces.
+      */
+     Bitboard getColorBitboard(int color) const { return colorBB[color]; }
+ 
+     /**
+      * @brief Gets the bitboard of all occupied squares.
+      * @return Bitboard of every piece on the board.
+      */
+     Bitboard getOccupiedBitboard() const { return occupiedBB; }
+ 
+     /**
+      * @brief Evaluates the position with the network if one is loaded, otherwise classically.
+      * @return The score in centipawns from the side to move's point of view.
+      */
+     int evaluate() const {
+         if (network) return network->evaluate(accumulator[sideToMove], accumulator[1 - sideToMove]);
+         return evaluateClassical();
+     }
+ 
+     /**
+      * @brief Evaluates the position from material and piece-square tables.
+      *
+      * The middlegame and endgame sums are kept up to date by setPieceAt, so this only blends
+      * them by the game phase (more weight on the endgame as pieces come off).
+      * @return The score in centipawns from the side to move's point of view.
+      */
+     int evaluateClassical() const {
+         int phase = gamePhase < PHASE_MAX ? gamePhase : PHASE_MAX;
+         int score = (middlegameScore * phase + endgameScore * (PHASE_MAX - phase)) / PHASE_MAX;
+         return sideToMove == COLOR_WHITE ? score : -score;
+     }
+ 
+     /**
+      * @brief Gets the square of a color's king.
+      * @param color The color index (COLOR_WHITE or COLOR_BLACK).
+      * @return The king's square index, or -1 if that color has no king.
+      */
+     int getKingSquare(int color) const { return kingSquare[color]; }
+ 
+     /**
+      * @brief Gets the color to move.
+      * @return COLOR_WHITE or COLOR_BLACK.
+      */
+     int getSideToMove() const { return sideToMove; }
+ 
+     /**
+      * @brief Gets the remaining castling rights.
+      * @return A bitmask of CASTLE_* flags.
+      */
+     int getCastlingRights() const { return castlingRights; }
+ 
+     /**
+      * @brief Gets the Zobrist key of the current position, maintained incrementally.
+      * @return The 64-bit position key.
+      */
+     HashKey getPositionKey() const { return positionKey; }
+ 
+     /**
+      * @brief Recomputes the Zobrist key from scratch (used to verify the incremental key).
+      * @return The 64-bit position key.
+      */
+     HashKey computePositionKey() const {
+         HashKey key = 0;
+         for (int c = 0; c < 2; c++) {
+             for (int t = 0; t < 6; t++) {
+                 Bitboard b = pieceBB[c][t];
+                 while (b) key ^= ZOBRIST.piece[c][t][popLsb(b)];
+             }
+         }
+         key ^= ZOBRIST.castling[castlingRights];
+         if (lastMoveWasPawnTwoSquares) key ^= ZOBRIST.enPassant[lastMoveToY];
+         if (sideToMove == COLOR_BLACK) key ^= ZOBRIST.blackToMove;
+         return key;
+     }
+ 
+     /**
+      * @brief Finds every piece, of either color, that attacks a square.
+      * @param sq The target square index.
+      * @param occupied The occupancy to use for sliding pieces.
+      * @return Bitboard of attacking pieces.
+      */
+     Bitboard attackersTo(int sq, Bitboard occupied) const {
+         Bitboard rooksQueens = pieceBB[COLOR_WHITE][ChessPiece::ROOK_TYPE] | pieceBB[COLOR_BLACK][ChessPiece::ROOK_TYPE] |
+                                pieceBB[COLOR_WHITE][ChessPiece::QUEEN_TYPE] | pieceBB[COLOR_BLACK][ChessPiece::QUEEN_TYPE];
+         Bitboard bishopsQueens = pieceBB[COLOR_WHITE][ChessPiece::BISHOP_TYPE] | pieceBB[COLOR_BLACK][ChessPiece::BISHOP_TYPE] |
+                                  pieceBB[COLOR_WHITE][ChessPiece::QUEEN_TYPE] | pieceBB[COLOR_BLACK][ChessPiece::QUEEN_TYPE];
+         return (pawnAttacks(COLOR_BLACK, sq) & pieceBB[COLOR_WHITE][ChessPiece::PAWN_TYPE])
+              | (pawnAttacks(COLOR_WHITE, sq) & pieceBB[COLOR_BLACK][ChessPiece::PAWN_TYPE])
+              | (knightAttacks(sq) & (pieceBB[COLOR_WHITE][ChessPiece::KNIGHT_TYPE] | pieceBB[COLOR_BLACK][ChessPiece::KNIGHT_TYPE]))
+              | (kingAttacks(sq) & (pieceBB[COLOR_WHITE][ChessPiece::KING_TYPE] | pieceBB[COLOR_BLACK][ChessPiece::KING_TYPE]))
+              | (rookAttacks(sq, occupied) & rooksQueens)
+              | (bishopAttacks(sq, occupied) & bishopsQueens);
+     }
+ 
+     /**
+      * @brief Checks if a move is valid for a piece (basic validation, e.g., not moving onto same-color piece).
+      * @param piece The piece to move.
+      * @param newX The target row.
+      * @param newY The target column.
+      * @return True if the move is valid, false otherwise.
+      */
+     bool isValidMove(const ChessPiece* piece, int newX, int newY) const {
+         if (!piece || newX < 0 || newX >= 8 || newY < 0 || newY >= 8) return false;
+         const ChessPiece* target = getPieceAt(newX, newY);
+         if (target && target->getColorIndex() == piece->getColorIndex()) return false;
+         return true;
+     }
+ 
+     /**
+      * @brief Checks if the king of a given color is in check.
+      * @param color The color of the king to check ("White" or "Black").
+      * @return True if the king is in check, false otherwise.
+      */
+     bool isKingInCheck(const string& color) const {
+         return isKingInCheck(color == "White" ? COLOR_WHITE : COLOR_BLACK);
+     }
+ 
+     /**
+      * @brief Checks if the king of a given color is in check.
+      * @param us The color index of the king to check.
+      * @return True if the king is in check, false otherwise.
+      */
+     bool isKingInCheck(int us) const {
+         if (kingSquare[us] < 0) return false;
+         return (attackersTo(kingSquare[us], occupiedBB) & colorBB[1 - us]) != 0;
+     }
+ 
+     /**
+      * @brief Checks if a square is under attack by a given color.
+      * @param x The row of the square.
+      * @param y The column of the square.
+      * @param attackerColor The color of the attacking pieces ("White" or "Black").
+      * @return True if the square is under attack, false otherwise.
+      */
+     bool isSquareUnderAttack(int x, int y, const string& attackerColor) const {
+         if (x < 0 || x > 7 || y < 0 || y > 7) return false;
+         int them = (attackerColor == "White") ? COLOR_WHITE : COLOR_BLACK;
+         return (attackersTo(squareIndex(x, y), occupiedBB) & colorBB[them]) != 0;
+     }
+ 
+     /**
+      * @brief Checks if a player can castle.
+      * @param color The player's color ("White" or "Black").
+      * @param kingside True for kingside castling, false for queenside.
+      * @return True if castling is possible, false otherwise.
+      */
+     bool canCastle(const string& color, bool kingside) const {
+         return canCastle(color == "White" ? COLOR_WHITE : COLOR_BLACK, kingside);
+     }
+ 
+     /**
+      * @brief Checks if a player can castle.
+      * @param us The player's color index.
+      * @param kingside True for kingside castling, false for queenside.
+      * @return True if castling is possible, false otherwise.
+      */
+     bool canCastle(int us, bool kingside) const {
+         int kingX = (us == COLOR_WHITE) ? 7 : 0;
+         int right = (us == COLOR_WHITE) ? (kingside ? CASTLE_WHITE_KINGSIDE : CASTLE_WHITE_QUEENSIDE)
+                                         : (kingside ? CASTLE_BLACK_KINGSIDE : CASTLE_BLACK_QUEENSIDE);
+         if (!(castlingRights & right)) return false;
+         int kingSq = squareIndex(kingX, 4);
+         int rookSq = squareIndex(kingX, kingside ? 7 : 0);
+         if (kingSquare[us] != kingSq) return false;
+         if (!(pieceBB[us][ChessPiece::ROOK_TYPE] & squareBit(rookSq))) return false;
+         if (betweenBB(kingSq, rookSq) & occupiedBB) return false;
+         int step = kingside ? 1 : -1;
+         for (int i = 0; i <= 2; i++) {
+             if (attackersTo(kingSq + i * step, occupiedBB) & colorBB[1 - us]) return false;
+         }
+         return true;
+     }
+ 
+     /**
+      * @brief Generates all legal moves for the side to move.
+      * @param list The list to fill (cleared first).
+      */
+     void generateLegalMoves(MoveList& list) const { generateLegalMoves(sideToMove, list); }
+ 
+     /**
+      * @brief Generates all legal moves for a color, including castling, en passant and all
+      *        four promotion choices.
+      * @param us The color index to generate moves for.
+      * @param list The list to fill (cleared first).
+      */
+     void generateLegalMoves(int us, MoveList& list) const {
+         list.clear();
+         generatePseudoLegalMoves(us, list);
+         keepLegalMoves(us, list);
+     }
+ 
+     /**
+      * @brief Generates the legal captures and promotions for the side to move.
+      * @param list The list to fill (cleared first).
+      */
+     void generateLegalNoisyMoves(MoveList& list) const {
+         list.clear();
+         generatePseudoLegalMoves(sideToMove, list, true);
+         keepLegalMoves(sideToMove, list);
+     }
+ 
+     /**
+      * @brief Removes the moves that would leave the mover's king in check.
+      * @param us The color index of the mover.
+      * @param list Pseudo-legal moves for us; compacted in place.
+      */
+     void keepLegalMoves(int us, MoveList& list) const {
+         CheckInfo info = computeCheckInfo(us);
+         int legal = 0;
+         for (int i = 0; i < list.size(); i++) {
+             if (isLegal(list[i], us, info)) list[legal++] = list[i];
+         }
+         list.resize(legal);
+     }
+ 
+     /**
+      * @brief Generates moves that follow the piece rules but may leave the own king in check.
+      * @param us The color index to generate moves for.
+      * @param list The list to append to.
+      * @param noisyOnly True to generate only captures and promotions.
+      */
+     void generatePseudoLegalMoves(int us, MoveList& list, bool noisyOnly = false) const {
+         int them = 1 - us;
+         Bitboard targets = noisyOnly ? colorBB[them] : ~colorBB[us];
+         int forward = (us == COLOR_WHITE) ? -8 : 8;
+         int startRow = (us == COLOR_WHITE) ? 6 : 1;
+         int promotionRow = (us == COLOR_WHITE) ? 0 : 7;
+         int enPassantSq = getEnPassantSquare();
+ 
+         Bitboard pawns = pieceBB[us][ChessPiece::PAWN_TYPE];
+         while (pawns) {
+             int from = popLsb(pawns);
+             int to = from + forward;
+             if (!(occupiedBB & squareBit(to)) && (!noisyOnly || to / 8 == promotionRow)) {
+                 addPawnMove(from, to, to / 8 == promotionRow, list);
+                 if (!noisyOnly && from / 8 == startRow && !(occupiedBB & squareBit(to + forward))) {
+                     addPawnMove(from, to + forward, false, list);
+                 }
+             }
+             Bitboard captures = pawnAttacks(us, from) & colorBB[them];
+             while (captures) addPawnMove(from, popLsb(captures), to / 8 == promotionRow, list);
+             if (enPassantSq >= 0 && (pawnAttacks(us, from) & squareBit(enPassantSq))) {
+                 list.add(Move(from / 8, from % 8, enPassantSq / 8, enPassantSq % 8, Move::EN_PASSANT));
+             }
+         }
+ 
+         for (int type = ChessPiece::ROOK_TYPE; type <= ChessPiece::KING_TYPE; type++) {
+             Bitboard pieces = pieceBB[us][type];
+             while (pieces) {
+                 int from = popLsb(pieces);
+                 Bitboard moves = pieceAttacks(type, from, occupiedBB) & targets;
+                 while (moves) {
+                     int to = popLsb(moves);
+                     list.add(Move(from / 8, from % 8, to / 8, to % 8));
+                 }
+             }
+         }
+ 
+         if (noisyOnly) return;
+         int kingX = (us == COLOR_WHITE) ? 7 : 0;
+         if (canCastle(us, true)) list.add(Move(kingX, 4, kingX, 6, Move::CASTLING));
+         if (canCastle(us, false)) list.add(Move(kingX, 4, kingX, 2, Move::CASTLING));
+     }
+ 
+     /**
+      * @brief Reads the check or mate mark that ends a SAN move, after any annotation marks.
+      * @param san The move text.
+      * @return '+', '#', or 0 if the move carries neither.
+      */
+     static char sanCheckMark(const string& san) {
+         size_t end = san.find_last_not_of("!?");
+         if (end == string::npos || (san[end] != '+' && san[end] != '#')) return 0;
+         return san[end];
+     }
+ 
+     /**
+      * @brief Finds the legal move written in Standard Algebraic Notation.
+      *
+      * Accepts forms such as "e4", "exd5", "Nbd7", "R1e2", "e8=Q" (or "e8Q") and "O-O-O" (or
+      * "0-0-0"). The text must describe exactly one legal move, so illegal and ambiguous moves
+      * are both rejected, and its 'x' must be present exactly when the move captures. Annotation
+      * marks ("!", "?") are ignored; a trailing check or mate mark is stripped but not checked
+      * here, as that needs the position after the move (see sanCheckMark).
+      * @param san The move text.
+      * @return The move, or a null move if it is malformed, illegal, ambiguous or mislabels a capture.
+      */
+     Move parseSan(const string& san) const {
+         static const string PIECE_LETTERS = "PRNBQK"; // Indexed by piece type.
+         string text = san;
+         while (!text.empty() && string("!?").find(text[text.size() - 1]) != string::npos) text.erase(text.size() - 1);
+         if (sanCheckMark(text)) text.erase(text.size() - 1);
+         MoveList moves;
+         generateLegalMoves(moves);
+         if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+             int toY = text.size() == 3 ? 6 : 2;
+             for (int i = 0; i < moves.size(); i++) {
+                 if (moves[i].getKind() == Move::CASTLING && moves[i].getToY() == toY) return moves[i];
+             }
+             return Move();
+         }
+ 
+         int promotion = -1;
+         size_t equals = text.find('=');
+         if (equals != string::npos) {
+             if (equals + 2 != text.size()) return Move();
+             promotion = (int)PIECE_LETTERS.find(text[equals + 1]);
+             if (promotion <= ChessPiece::PAWN_TYPE || promotion == ChessPiece::KING_TYPE) return Move();
+             text.erase(equals);
+         } else if (text.size() >= 3 && text[text.size() - 1] >= 'B' && text[text.size() - 1] <= 'R') {
+             promotion = (int)PIECE_LETTERS.find(text[text.size() - 1]);
+             if (promotion <= ChessPiece::PAWN_TYPE || promotion == ChessPiece::KING_TYPE) return Move();
+             text.erase(text.size() - 1);
+         }
+         if (text.size() < 2) return Move();
+         char file = text[text.size() - 2], rank = text[text.size() - 1];
+         if (file < 'a' || file > 'h' || rank < '1' || rank > '8') return Move();
+         int to = squareIndex('8' - rank, file - 'a');
+ 
+         string prefix = text.substr(0, text.size() - 2);
+         int type = ChessPiece::PAWN_TYPE;
+         if (!prefix.empty() && prefix[0] >= 'A' && prefix[0] <= 'Z') {
+             type = (int)PIECE_LETTERS.find(prefix[0]);
+             if (type <= ChessPiece::PAWN_TYPE) return Move();
+             prefix.erase(0, 1);
+         }
+         bool capture = !prefix.empty() && prefix[prefix.size() - 1] == 'x';
+         if (capture) prefix.erase(prefix.size() - 1);
+         int fromY = -1, fromX = -1;
+         for (size_t i = 0; i < prefix.size(); i++) {
+             if (prefix[i] >= 'a' && prefix[i] <= 'h') fromY = prefix[i] - 'a';
+             else if (prefix[i] >= '1' && prefix[i] <= '8') fromX = '8' - prefix[i];
+             else return Move();
+         }
+ 
+         Move found;
+         int matches = 0;
+         for (int i = 0; i < moves.size(); i++) {
+             const Move& move = moves[i];
+             if (move.getTo() != to || move.getKind() == Move::CASTLING) continue;
+             if (pieceType(getPieceCode(move.getFrom())) != type) continue;
+             if ((fromY >= 0 && move.getFromY() != fromY) || (fromX >= 0 && move.getFromX() != fromX)) continue;
+             if (move.getKind() == Move::PROMOTION ? move.getPromotionType() != promotion : promotion >= 0) continue;
+             if (capture != (getPieceCode(move.getTo()) != NO_PIECE || move.getKind() == Move::EN_PASSANT)) continue;
+             found = move;
+             matches++;
+         }
+         return matches == 1 ? found : Move();
+     }
+ 
+     /**
+      * @brief Resolves the capture sequence a move starts on its destination square.
+      *
+      * Both sides recapture with their least valuable attacker, and either side may stop
+      * when continuing would lose material. Attackers are recomputed from the shrinking
+      * occupancy, so sliders lined up behind a capturer join in. Pins are ignored.
+      * @param move A legal move for the side to move.
+      * @return The material the mover gains in centipawns (SEE_VALUE), negative if the move loses
+      *         material; 0 for quiet moves to safe squares and for castling.
+      */
+     int staticExchange(const Move& move) const {
+         static const int LEAST_VALUABLE_FIRST[6] = {ChessPiece::PAWN_TYPE, ChessPiece::KNIGHT_TYPE,
+                                                     ChessPiece::BISHOP_TYPE, ChessPiece::ROOK_TYPE,
+                                                     ChessPiece::QUEEN_TYPE, ChessPiece::KING_TYPE};
+         if (move.getKind() == Move::CASTLING) return 0;
+         int from = move.getFrom(), to = move.getTo();
+         int side = pieceColor(getPieceCode(from));
+         int onSquare = pieceType(getPieceCode(from));
+         Bitboard occupied = occupiedBB & ~squareBit(from);
+         int gain[32];
+         if (move.getKind() == Move::EN_PASSANT) {
+             occupied &= ~squareBit(squareIndex(from / 8, to % 8));
+             gain[0] = SEE_VALUE[ChessPiece::PAWN_TYPE];
+         } else {
+             PieceCode captured = getPieceCode(to);
+             gain[0] = captured != NO_PIECE ? SEE_VALUE[pieceType(captured)] : 0;
+         }
+         if (move.getKind() == Move::PROMOTION) {
+             onSquare = move.getPromotionType();
+             gain[0] += SEE_VALUE[onSquare] - SEE_VALUE[ChessPiece::PAWN_TYPE];
+         }
+ 
+         int depth = 0;
+         Bitboard attackers = attackersTo(to, occupied) & occupied;
+         while (depth < 31) {
+             side = 1 - side;
+             Bitboard own = attackers & colorBB[side];
+             if (!own) break;
+             int type = ChessPiece::KING_TYPE;
+             for (int i = 0; i < 6; i++) {
+                 if (own & pieceBB[side][LEAST_VALUABLE_FIRST[i]]) {
+                     type = LEAST_VALUABLE_FIRST[i];
+                     break;
+                 }
+             }
+             if (type == ChessPiece::KING_TYPE && (attackers & colorBB[1 - side])) break;
+             depth++;
+             gain[depth] = SEE_VALUE[onSquare] - gain[depth - 1];
+             occupied &= ~squareBit(lsbIndex(own & pieceBB[side][type]));
+             attackers = attackersTo(to, occupied) & occupied;
+             onSquare = type;
+         }
+         while (depth > 0) {
+             if (gain[depth] > -gain[depth - 1]) gain[depth - 1] = -gain[depth];
+             depth--;
+         }
+         return gain[0];
+     }
+ 
+     /**
+      * @brief Finds the checkers, pinned pieces and evasion mask for a side's king.
+      * @param us The color index of the king's side.
+      * @return The check information (no checkers or pins if the side has no king).
+      */
+     CheckInfo computeCheckInfo(int us) const {
+         CheckInfo info;
+         info.checkers = info.pinned = 0;
+         info.evasionMask = ~0ULL;
+         int kingSq = kingSquare[us];
+         if (kingSq < 0) return info;
+         int them = 1 - us;
+         info.checkers = attackersTo(kingSq, occupiedBB) & colorBB[them];
+         Bitboard queens = pieceBB[them][ChessPiece::QUEEN_TYPE];
+         Bitboard snipers = (rookAttacks(kingSq, 0) & (pieceBB[them][ChessPiece::ROOK_TYPE] | queens))
+                          | (bishopAttacks(kingSq, 0) & (pieceBB[them][ChessPiece::BISHOP_TYPE] | queens));
+         while (snipers) {
+             Bitboard blockers = betweenBB(kingSq, popLsb(snipers)) & occupiedBB;
+             if (popCount(blockers) == 1) info.pinned |= blockers & colorBB[us];
+         }
+         if (info.checkers) {
+             info.evasionMask = popCount(info.checkers) > 1 ? 0 : info.checkers | betweenBB(kingSq, lsbIndex(info.checkers));
+         }
+         return info;
+     }
+ 
+     /**
+      * @brief Checks whether a pseudo-legal move leaves the mover's king safe.
+      *
+      * Ordinary moves only need the evasion mask and pin rays. King moves and en passant,
+      * which change which lines are open to the king, are tested against an occupancy with
+      * the move applied; the board itself is never modified.
+      * @param move The move to test.
+      * @param us The color index of the mover.
+      * @param info The mover's check information from computeCheckInfo.
+      * @return True if the move is legal.
+      */
+     bool isLegal(const Move& move, int us, const CheckInfo& info) const {
+         if (move.getKind() == Move::CASTLING) return true;
+         int from = move.getFrom();
+         int to = move.getTo();
+         int kingSq = kingSquare[us];
+         if (kingSq < 0) return true;
+         int them = 1 - us;
+         if (from == kingSq) {
+             return !(attackersTo(to, occupiedBB & ~squareBit(from)) & colorBB[them] & ~squareBit(to));
+         }
+         if (move.getKind() == Move::EN_PASSANT) {
+             Bitboard captured = squareBit(squareIndex(from / 8, to % 8));
+             Bitboard occupied = ((occupiedBB & ~squareBit(from)) | squareBit(to)) & ~captured;
+             return !(attackersTo(kingSq, occupied) & colorBB[them] & ~captured);
+         }
+         if (!(info.evasionMask & squareBit(to))) return false;
+         return !(info.pinned & squareBit(from)) || (lineBB(kingSq, from) & squareBit(to));
+     }
+ 
+     /**
+      * @brief Checks whether a pseudo-legal move leaves the mover's king safe.
+      * @param move The move to test.
+      * @param us The color index of the mover.
+      * @return True if the move is legal.
+      */
+     bool isLegal(const Move& move, int us) const { return isLegal(move, us, computeCheckInfo(us)); }
+ 
+     /**
+      * @brief Gets the square a pawn could capture onto en passant.
+      * @return The en passant square index, or -1 if none.
+      */
+     int getEnPassantSquare() const {
+         if (!lastMoveWasPawnTwoSquares) return -1;
+         return squareIndex((lastMoveFromX + lastMoveToX) / 2, lastMoveToY);
+     }
+ 
+     /**
+      * @brief Determines if the game is over for a player.
+      * @param color The player's color ("White" or "Black").
+      * @return GAME_NONE if the game continues, GAME_CHECKMATE if checkmate, or GAME_STALEMATE if stalemate.
+      */
+     int isGameOver(const string& color) const {
+         return isGameOver(color == "White" ? COLOR_WHITE : COLOR_BLACK);
+     }
+ 
+     /**
+      * @brief Determines if the game is over for a player.
+      * @param us The player's color index.
+      * @return GAME_NONE if the game continues, GAME_CHECKMATE if checkmate, or GAME_STALEMATE if stalemate.
+      */
+     int isGameOver(int us) const {
+         MoveList moves;
+         generateLegalMoves(us, moves);
+         if (moves.size() > 0) return GAME_NONE;
+         return isKingInCheck(us) ? GAME_CHECKMATE : GAME_STALEMATE;
+     }
+ 
+     /**
+      * @brief Makes a legal move, recording what is needed to take it back.
+      *
+      * Only piece codes change hands, so making and taking back a move never allocates, and
+      * doMove followed by undoMove restores the board exactly.
+      * @param move A legal move for the side to move.
+      */
+     void doMove(const Move& move) {
+         int fromX = move.getFromX(), fromY = move.getFromY();
+         int toX = move.getToX(), toY = move.getToY();
+         UndoRecord record;
+         record.move = move;
+         record.positionKey = positionKey;
+         record.halfMoveClock = (short)halfMoveClock;
+         record.castlingRights = (signed char)castlingRights;
+         record.lastMoveFrom = (signed char)(lastMoveFromX < 0 ? -1 : squareIndex(lastMoveFromX, lastMoveFromY));
+         record.lastMoveTo = (signed char)(lastMoveToX < 0 ? -1 : squareIndex(lastMoveToX, lastMoveToY));
+         record.lastMoveWasPawnTwoSquares = lastMoveWasPawnTwoSquares;
+ 
+         PieceCode piece = squares[fromX][fromY].getPiece();
+         int captureX = (move.getKind() == Move::EN_PASSANT) ? fromX : toX;
+         record.captured = squares[captureX][toY].getPiece();
+         if (record.captured != NO_PIECE) setPieceAt(captureX, toY, NO_PIECE);
+         setPieceAt(fromX, fromY, NO_PIECE);
+         setPieceAt(toX, toY, piece);
+ 
+         if (move.getKind() == Move::CASTLING) {
+             int rookFromY = (toY > fromY) ? 7 : 0;
+             int rookToY = (toY > fromY) ? 5 : 3;
+             PieceCode rook = squares[fromX][rookFromY].getPiece();
+             setPieceAt(fromX, rookFromY, NO_PIECE);
+             setPieceAt(fromX, rookToY, rook);
+         } else if (move.getKind() == Move::PROMOTION) {
+             setPieceAt(toX, toY, makePiece(pieceColor(piece), move.getPromotionType()));
+         }
+ 
+         undoStack.push_back(record);
+         recordMove(fromX, fromY, toX, toY, pieceType(piece), record.captured != NO_PIECE);
+     }
+ 
+     /**
+      * @brief Takes back the last move made with doMove.
+      */
+     void undoMove() {
+         if (undoStack.empty()) return;
+         UndoRecord record = undoStack.back();
+         undoStack.pop_back();
+         positionHistory.pop();
+ 
+         const Move& move = record.move;
+         int fromX = move.getFromX(), fromY = move.getFromY();
+         int toX = move.getToX(), toY = move.getToY();
+         PieceCode piece = squares[toX][toY].getPiece();
+         if (move.getKind() == Move::PROMOTION) piece = makePiece(pieceColor(piece), ChessPiece::PAWN_TYPE);
+         setPieceAt(toX, toY, NO_PIECE);
+         setPieceAt(fromX, fromY, piece);
+         if (move.getKind() == Move::CASTLING) {
+             int rookFromY = (toY > fromY) ? 7 : 0;
+             int rookToY = (toY > fromY) ? 5 : 3;
+             PieceCode rook = squares[fromX][rookToY].getPiece();
+             setPieceAt(fromX, rookToY, NO_PIECE);
+             setPieceAt(fromX, rookFromY, rook);
+         }
+         if (record.captured != NO_PIECE) {
+             setPieceAt((move.getKind() == Move::EN_PASSANT) ? fromX : toX, toY, record.captured);
+         }
+ 
+         sideToMove = 1 - sideToMove;
+         if (sideToMove == COLOR_BLACK) fullMoveNumber--;
+         castlingRights = record.castlingRights;
+         halfMoveClock = record.halfMoveClock;
+         lastMoveFromX = record.lastMoveFrom < 0 ? -1 : record.lastMoveFrom / 8;
+         lastMoveFromY = record.lastMoveFrom < 0 ? -1 : record.lastMoveFrom % 8;
+         lastMoveToX = record.lastMoveTo < 0 ? -1 : record.lastMoveTo / 8;
+         lastMoveToY = record.lastMoveTo < 0 ? -1 : record.lastMoveTo % 8;
+         lastMoveWasPawnTwoSquares = record.lastMoveWasPawnTwoSquares;
+         positionKey = record.positionKey;
+     }
+ 
+     /**
+      * @brief Promotes a pawn to a new piece type.
+      * @param x The row of the pawn.
+      * @param y The column of the pawn.
+      * @param pieceType The type to promote to ("Queen", "Rook", "Bishop", "Knight").
+      * @param color The color of the pawn.
+      * @return View of the new piece, or nullptr if promotion fails.
+      */
+     const ChessPiece* promotePawn(int x, int y, const string& pieceType, const string& color) {
+         const ChessPiece* piece = getPieceAt(x, y);
+         if (!piece || piece->getType() != ChessPiece::PAWN_TYPE) return nullptr;
+         int type;
+         if (pieceType == "Queen") type = ChessPiece::QUEEN_TYPE;
+         else if (pieceType == "Rook") type = ChessPiece::ROOK_TYPE;
+         else if (pieceType == "Bishop") type = ChessPiece::BISHOP_TYPE;
+         else if (pieceType == "Knight") type = ChessPiece::KNIGHT_TYPE;
+         else return nullptr;
+         setPieceAt(x, y, makePiece(color == "White" ? COLOR_WHITE : COLOR_BLACK, type));
+         return getPieceAt(x, y);
+     }
+ 
+     /**
+      * @brief Checks if the game is a draw by the 50-move rule.
+      * @return True if 50 moves have passed without a capture or pawn move, false otherwise.
+      */
+     bool isFiftyMoveDraw() const { return halfMoveClock >= 100; }
+ 
+     /**
+      * @brief Checks if the game is a draw by threefold repetition.
+      * @return True if the same position has occurred three times, false otherwise.
+      */
+     bool isThreefoldRepetition() const { return positionHistory.currentCount() >= 3; }
+ 
+     /**
+      * @brief Gets how often the current position has occurred, counting this occurrence.
+      * @return The number of occurrences (1 for a new position).
+      */
+     int getRepetitionCount() const { return positionHistory.currentCount(); }
+ 
+     /**
+      * @brief Updates the move history for draw rules, en passant, castling rights and side to move.
+      *
+      * Piece placement is already folded into the position key by setPieceAt; this adds the
+      * remaining state changes with a few XORs.
+      * @param fromX The starting row.
+      * @param fromY The starting column.
+      * @param toX The ending row.
+      * @param toY The ending column.
+      * @param piece The piece that moved.
+      * @param isCapture True if the move was a capture, false otherwise.
+      */
+     void updateMoveHistory(int fromX, int fromY, int toX, int toY, const ChessPiece* piece, bool isCapture) {
+         recordMove(fromX, fromY, toX, toY, piece ? piece->getType() : -1, isCapture);
+     }
+ 
+     /**
+      * @brief Updates the move history given the type of the piece that moved.
+      * @param fromX The starting row.
+      * @param fromY The starting column.
+      * @param toX The ending row.
+      * @param toY The ending column.
+      * @param movedType The type of the piece that moved (-1 if unknown).
+      * @param isCapture True if the move was a capture, false otherwise.
+      */
+     void recordMove(int fromX, int fromY, int toX, int toY, int movedType, bool isCapture) {
+         if (lastMoveWasPawnTwoSquares) positionKey ^= ZOBRIST.enPassant[lastMoveToY];
+         positionKey ^= ZOBRIST.castling[castlingRights];
+         castlingRights &= CASTLING_RIGHTS_MASK[squareIndex(fromX, fromY)] & CASTLING_RIGHTS_MASK[squareIndex(toX, toY)];
+         positionKey ^= ZOBRIST.castling[castlingRights];
+         lastMoveFromX = fromX;
+         lastMoveFromY = fromY;
+         lastMoveToX = toX;
+         lastMoveToY = toY;
+         lastMoveWasPawnTwoSquares = false;
+         if (movedType == ChessPiece::PAWN_TYPE) {
+             int diff = toX - fromX;
+             if ((diff == 2 || diff == -2) && fromY == toY) lastMoveWasPawnTwoSquares = true;
+         }
+         halfMoveClock++;
+         if (isCapture || movedType == ChessPiece::PAWN_TYPE) halfMoveClock = 0;
+         if (lastMoveWasPawnTwoSquares) positionKey ^= ZOBRIST.enPassant[lastMoveToY];
+         if (sideToMove == COLOR_BLACK) fullMoveNumber++;
+         sideToMove = 1 - sideToMove;
+         positionKey ^= ZOBRIST.blackToMove;
+         positionHistory.push(positionKey, halfMoveClock);
+     }
+ 
+     /**
+      * @brief Converts board indices to algebraic notation.
+      * @param x The row index.
+      * @param y The column index.
+      * @return The position in algebraic notation (e.g., "e4").
+      */
+     string algebraicFromIndices(int x, int y) const {
+         string pos;
+         pos += char('a' + y);
+         pos += char('8' - x);
+         return pos;
+     }
+ 
+     /**
+      * @brief Gets the halfmove clock used by the 50-move rule.
+      * @return Plies since the last capture or pawn move.
+      */
+     int getHalfMoveClock() const { return halfMoveClock; }
+ 
+     /**
+      * @brief Gets the current move number.
+      * @return The fullmove number, starting at 1.
+      */
+     int getFullMoveNumber() const { return fullMoveNumber; }
+ 
+     /**
+      * @brief Gets the row of the last move's ending position.
+      * @return The row index.
+      */
+     int getLastMoveToX() const { return lastMoveToX; }
+ 
+     /**
+      * @brief Gets the row of the last move's starting position.
+      * @return The row index.
+      */
+     int getLastMoveFromX() const { return lastMoveFromX; }
+ };
+ 
+ const int MAX_PLY = 64;            ///< Deepest ply the search can reach.
+ const int SCORE_INFINITE = 32000;  ///< Bound larger than any score.
+ const int SCORE_MATE = 31000;      ///< Score of giving mate at the root; mate in n plies scores SCORE_MATE - n.
+ static_assert(NNUE_MAX_SCORE < SCORE_MATE - MAX_PLY, "static evaluations must stay out of the mate band");
+ 
+ const int ORDER_CAPTURE = 1000000;     ///< Ordering score of captures and queen promotions, plus their MVV-LVA term.
+ const int ORDER_KILLER = 900000;       ///< Ordering score of the first killer (the second scores one less).
+ const int ORDER_COUNTER = 800000;      ///< Ordering score of the countermove.
+ const int ORDER_UNDERPROMOTION = -1000000; ///< Ordering score of underpromotions, tried last.
+ const int HISTORY_MAX = 16384;         ///< History scores stay within [-HISTORY_MAX, HISTORY_MAX].
+ const int ORDER_RANK[6] = {1, 4, 2, 3, 5, 6}; ///< Piece types ranked by value (pawn lowest), for MVV-LVA.
+ 
+ const size_t DEFAULT_HASH_MB = 16; ///< Default transposition table size.
+ const int BOUND_UPPER = 1; ///< The stored score is an upper bound (no move raised alpha).
+ const int BOUND_LOWER = 2; ///< The stored score is a lower bound (a move failed high).
+ const int BOUND_EXACT = 3; ///< The stored score is exact.
+ 
+ /**
+  * @brief What the transposition table remembers about a position.
+  */
+ struct TTEntry {
+     Move move;       ///< Best move found (null if none).
+     int score;       ///< Score, with mate scores relative to the stored position.
+     int depth;       ///< Depth the score was searched to.
+     int bound;       ///< BOUND_UPPER, BOUND_LOWER or BOUND_EXACT.
+ };
+ 
+ /**
+  * @brief Fixed-size hash table of search results shared by all search threads without locks.
+  *
+  * Each entry is two 64-bit atomics: the packed data and the position key XOR the data. A
+  * reader accepts an entry only if the two words still match its key, so an entry torn by
+  * a concurrent write is simply a miss. Four entries make a 64-byte bucket, one cache line
+  * per probe. Entries from older searches are replaced first, then the shallowest ones.
+  */
+ class TranspositionTable {
+ private:
+     /**
+      * @brief One slot: the key check word and the packed data.
+      */
+     struct Slot {
+         atomic<unsigned long long> check; ///< Position key XOR data.
+         atomic<unsigned long long> data;  ///< move | score << 16 | depth << 32 | bound << 40 | generation << 42.
+     };
+ 
+     /**
+      * @brief Four slots filling one cache line.
+      */
+     struct alignas(64) Bucket {
+         Slot slots[4]; ///< The bucket's entries.
+     };
+ 
+     vector<Bucket> buckets;      ///< The table.
+     unsigned generation;         ///< Incremented once per search, used to age entries.
+ 
+     /**
+      * @brief Finds the bucket for a key.
+      * @param key The position key.
+      * @return The bucket (the high bits of key * size, so any size spreads evenly).
+      */
+     Bucket& bucketFor(HashKey key) {
+         return buckets[(size_t)(((unsigned __int128)key * buckets.size()) >> 64)];
+     }
+ 
+ public:
+     /**
+      * @brief Creates a table of a given size.
+      * @param megabytes The size in MB (at least one bucket is allocated).
+      */
+     explicit TranspositionTable(size_t megabytes) : generation(0) { resize(megabytes); }
+ 
+     /**
+      * @brief Reallocates the table, discarding its contents. Not safe while a search is running.
+      * @param megabytes The new size in MB.
+      */
+     void resize(size_t megabytes) {
+         size_t count = megabytes * 1024 * 1024 / sizeof(Bucket);
+         buckets = vector<Bucket>(count ? count : 1);
+         clear();
+     }
+ 
+     /**
+      * @brief Empties every entry. Not safe while a search is running.
+      */
+     void clear() {
+         for (size_t i = 0; i < buckets.size(); i++) {
+             for (int j = 0; j < 4; j++) {
+                 buckets[i].slots[j].check.store(0, memory_order_relaxed);
+                 buckets[i].slots[j].data.store(0, memory_order_relaxed);
+             }
+         }
+         generation = 0;
+     }
+ 
+     /**
+      * @brief Starts a new search, so entries from earlier searches age.
+      */
+     void newSearch() { generation = (generation + 1) & 0xFF; }
+ 
+     /**
+      * @brief Gets the table size.
+      * @return The size in MB.
+      */
+     size_t sizeMB() const { return buckets.size() * sizeof(Bucket) / (1024 * 1024); }
+ 
+     /**
+      * @brief Looks up a position.
+      * @param key The position key.
+      * @param entry Output: the stored result if found.
+      * @return True if the position was found.
+      */
+     bool probe(HashKey key, TTEntry& entry) {
+         Bucket& bucket = bucketFor(key);
+         for (int i = 0; i < 4; i++) {
+             unsigned long long data = bucket.slots[i].data.load(memory_order_relaxed);
+             unsigned long long check = bucket.slots[i].check.load(memory_order_relaxed);
+             if (data == 0 || (check ^ data) != key) continue;
+             entry.move = Move::fromData((unsigned short)(data & 0xFFFF));
+             entry.score = (short)((data >> 16) & 0xFFFF);
+             entry.depth = (int)((data >> 32) & 0xFF);
+             entry.bound = (int)((data >> 40) & 3);
+             return true;
+         }
+         return false;
+     }
+ 
+     /**
+      * @brief Stores a search result, replacing the same position or the least valuable entry.
+      * @param key The position key.
+      * @param move The best move (null keeps the move already stored for this position).
+      * @param score The score, with mate scores relative to this position.
+      * @param depth The depth searched.
+      * @param bound BOUND_UPPER, BOUND_LOWER or BOUND_EXACT.
+      */
+     void store(HashKey key, Move move, int score, int depth, int bound) {
+         Bucket& bucket = bucketFor(key);
+         Slot* target = &bucket.slots[0];
+         int worst = 1 << 30;
+         for (int i = 0; i < 4; i++) {
+             Slot& slot = bucket.slots[i];
+             unsigned long long data = slot.data.load(memory_order_relaxed);
+             if (data == 0 || (slot.check.load(memory_order_relaxed) ^ data) == key) {
+                 target = &slot;
+                 if (data && move.isNull()) move = Move::fromData((unsigned short)(data & 0xFFFF));
+                 break;
+             }
+             int age = (int)((generation - (data >> 42)) & 0xFF);
+             int value = (int)((data >> 32) & 0xFF) - 8 * age;
+             if (value < worst) {
+                 worst = value;
+                 target = &slot;
+             }
+         }
+         unsigned long long data = (unsigned long long)move.getData()
+                                 | (unsigned long long)(unsigned short)(short)score << 16
+                                 | (unsigned long long)(depth < 0 ? 0 : depth > 255 ? 255 : depth) << 32
+                                 | (unsigned long long)bound << 40
+                                 | (unsigned long long)generation << 42;
+         target->data.store(data, memory_order_relaxed);
+         target->check.store(key ^ data, memory_order_relaxed);
+     }
+ 
+     /**
+      * @brief Estimates how full the table is with entries from the current search.
+      * @return Permille of sampled slots written during this search.
+      */
+     int hashfull() const {
+         size_t sample = buckets.size() < 250 ? buckets.size() : 250;
+         int used = 0;
+         for (size_t i = 0; i < sample; i++) {
+             for (int j = 0; j < 4; j++) {
+                 unsigned long long data = buckets[i].slots[j].data.load(memory_order_relaxed);
+                 if (data && (data >> 42) == generation) used++;
+             }
+         }
+         return sample ? (int)(used * 1000 / (sample * 4)) : 0;
+     }
+ };
+ 
+ const int INFO_NONE = 0;    ///< Print nothing while searching.
+ const int INFO_CONSOLE = 1; ///< Print a readable line per finished iteration.
+ const int INFO_UCI = 2;     ///< Print UCI "info" lines.
+ 
+ mutex outputMutex; ///< Serializes lines written by the search and UCI input threads.
+ 
+ /**
+  * @brief Writes a whole line to standard output and flushes it.
+  *
+  * Lines from different threads never interleave, and a GUI reading through a pipe sees
+  * each line as soon as it is written.
+  * @param line The line, without the newline.
+  */
+ void printLine(const string& line) {
+     lock_guard<mutex> lock(outputMutex);
+     cout << line << endl;
+ }
+ 
+ /**
+  * @brief Limits on a search; it stops at whichever is reached first.
+  */
+ struct SearchLimits {
+     int depth;          ///< Deepest iteration to start, in plies.
+     long long nodes;    ///< Node budget (0 for none).
+     int moveTimeMs;     ///< Time budget in milliseconds, never exceeded (0 for none).
+     int softTimeMs;     ///< Time the TimeManager aims to spend, scaled as the search goes (0 for none).
+     int multiPv;        ///< Number of best lines to find and report (1 for the best move only).
+ 
+     SearchLimits() : depth(MAX_PLY - 1), nodes(0), moveTimeMs(0), softTimeMs(0), multiPv(1) {}
+ };
+ 
+ /**
+  * @brief One analysed line: a root move, its score and the variation that follows.
+  */
+ struct PvLine {
+     int score;          ///< Score in centipawns from the side to move's point of view.
+     MoveList pv;        ///< The variation, starting with the root move.
+ };
+ 
+ /**
+  * @brief The outcome of a search: the best move from the deepest finished iteration.
+  */
+ struct SearchResult {
+     Move bestMove;      ///< Move to play (null if the side to move has no legal moves).
+     int score;          ///< Score in centipawns from the side to move's point of view.
+     int depth;          ///< Depth of the last finished iteration.
+     long long nodes;    ///< Nodes visited in total.
+     MoveList pv;        ///< Principal variation, starting with bestMove.
+     vector<PvLine> lines; ///< The best lines, best first (more than one only in multi-PV searches).
+ };
+ 
+ /**
+  * @brief State shared by the threads of one search.
+  */
+ struct SearchShared {
+     atomic<bool> stop;        ///< Set by the main thread to end the search on every thread.
+     atomic<long long> nodes;  ///< Nodes visited by all threads (each adds its count when it polls).
+     atomic<bool> ponder;      ///< True while searching on the opponent's time; clearing it is the ponder hit.
+ 
+     SearchShared() : stop(false), nodes(0), ponder(false) {}
+ };
+ 
+ /**
+  * @brief Root moves handed out to several threads in one multi-PV iteration.
+  */
+ struct RootSplit {
+     MoveList moves;          ///< Root moves to search, most promising first.
+     atomic<int> next;        ///< Index of the next move to hand out.
+     vector<PvLine> results;  ///< One line per move; an empty pv means the move was not finished.
+ 
+     RootSplit() : next(0) {}
+ };
+ 
+ /**
+  * @brief Decides how long a clock-limited search may run.
+  *
+  * allocate turns the clock into a soft target and a hard cap. The search never runs past
+  * the hard cap; after each iteration the main thread asks shouldStop, which scales the
+  * soft target up while the best move keeps changing or the score falls, and down when the
+  * best move is stable or has taken most of the search's effort.
+  */
+ class TimeManager {
+ private:
+     bool hasLast;           ///< True once an iteration has been seen, so lastBest and lastScore are real.
+     Move lastBest;          ///< Best move of the previous iteration.
+     int lastScore;          ///< Score of the previous iteration.
+     int stableIterations;   ///< Consecutive iterations that kept the same best move.
+ 
+ public:
+     static const int MOVE_OVERHEAD_MS = 30;     ///< Time kept back per move for communication delays.
+     static const int DEFAULT_MOVES_TO_GO = 30;  ///< Moves assumed left when the control does not say.
+ 
+     TimeManager() : hasLast(false), lastScore(0), stableIterations(0) {}
+ 
+     /**
+      * @brief Sets the soft target and hard cap of a search from the clock.
+      * @param limits The limits to update (softTimeMs and moveTimeMs).
+      * @param remainingMs Time left on the side to move's clock.
+      * @param incrementMs Increment per move.
+      * @param movesToGo Moves until the next time control (0 if unknown or sudden death).
+      */
+     static void allocate(SearchLimits& limits, long long remainingMs, long long incrementMs, int movesToGo) {
+         long long usable = remainingMs - MOVE_OVERHEAD_MS;
+         if (usable < 1) usable = 1;
+         int moves = movesToGo > 0 ? movesToGo : DEFAULT_MOVES_TO_GO;
+         long long soft = usable / moves + incrementMs * 3 / 4;
+         long long hard = soft * 4;
+         // Never bet more than half the clock on one move unless it is the last before the control.
+         long long cap = moves == 1 ? usable : usable / 2;
+         if (hard > cap) hard = cap;
+         if (soft > hard) soft = hard;
+         limits.softTimeMs = (int)(soft > 1 ? soft : 1);
+         limits.moveTimeMs = (int)(hard > 1 ? hard : 1);
+     }
+ 
+     /**
+      * @brief Decides after a finished iteration whether to start another one.
+      * @param softTimeMs The soft target from allocate.
+      * @param elapsedMs Time spent so far.
+      * @param best The iteration's best move.
+      * @param score The iteration's score.
+      * @param bestMoveShare Permille of the root nodes spent below the best move.
+      * @return True if the search should stop now.
+      */
+     bool shouldStop(int softTimeMs, long long elapsedMs, const Move& best, int score, int bestMoveShare) {
+         static const int STABILITY_PERCENT[5] = {200, 140, 115, 100, 85};
+         // The first iteration has nothing to compare with, so neither stability nor a score drop applies.
+         long long target = softTimeMs;
+         if (hasLast) {
+             stableIterations = best == lastBest ? stableIterations + 1 : 0;
+             target = target * STABILITY_PERCENT[stableIterations < 4 ? stableIterations : 4] / 100;
+         }
+         int drop = hasLast ? lastScore - score : 0;
+         hasLast = true;
+         lastBest = best;
+         lastScore = score;
+         if (drop > 0) target = target * (100 + (drop < 100 ? drop : 100)) / 100;
+         // A best move that took most of the effort is unlikely to be overturned, and vice versa.
+         int effortPercent = 200 - bestMoveShare * 3 / 20;
+         target = target * (effortPercent < 50 ? 50 : effortPercent > 150 ? 150 : effortPercent) / 100;
+         // The next iteration costs more than everything so far, so do not start one past half the target.
+         return elapsedMs * 2 >= target;
+     }
+ };
+ 
+ /**
+  * @brief Negamax alpha-beta search with iterative deepening.
+  *
+  * Works on its own copy of the board through doMove/undoMove, so the legal move generator
+  * stays the only source of truth for the rules. Each iteration searches the previous
+  * iteration's principal variation first; elsewhere the transposition table's move goes
+  * first, and its bounds cut off positions already searched deeply enough. The other moves
+  * are picked best-first: captures by MVV-LVA, then killers, the countermove and history.
+  * At depth 0 a quiescence search resolves pending captures before evaluating.
+  * The iteration line's firstcut figure is the share of cutoffs made by the first move.
+  *
+  * Several searches can run the same root at once (Lazy SMP, see runThreads). They share
+  * only the transposition table and a SearchShared; helper threads skip some depths so they
+  * spread over different parts of the tree, and the main thread decides when all stop.
+  */
+ class Search {
+ private:
+     ChessBoard board;                    ///< The search's own copy of the position.
+     SearchLimits limits;                 ///< When to stop.
+     TranspositionTable& tt;              ///< Table shared with other searches.
+     long long ttProbes;                  ///< Transposition table lookups.
+     long long ttHits;                    ///< Lookups that found the position.
+     int infoStyle;                       ///< INFO_NONE, INFO_CONSOLE or INFO_UCI.
+     chrono::steady_clock::time_point start; ///< When the search began.
+     long long nodes;                     ///< Nodes visited so far.
+     long long publishedNodes;            ///< Part of nodes already added to the shared count.
+     int pollCountdown;                   ///< Nodes left until the next poll of the limits.
+     TimeManager timeManager;             ///< Soft time decisions between iterations (main thread only).
+     bool ponderActive;                   ///< True until this thread sees the ponder hit.
+     long long rootMoveNodes[64][64];     ///< Nodes spent below each root move, by from and to square.
+     MoveList excludedRoot;               ///< Root moves skipped because earlier multi-PV lines took them.
+     vector<PvLine> previousLines;        ///< Lines of the last finished iteration.
+     vector<Search*> rootHelpers;         ///< Threads that share out root moves in multi-PV iterations.
+     bool stopped;                        ///< Set once a limit is hit; the current iteration is discarded.
+     Move pvTable[MAX_PLY][MAX_PLY];      ///< Triangular principal variation table.
+     int pvLength[MAX_PLY];               ///< Length of the variation stored at each ply.
+     Move previousPv[MAX_PLY];            ///< Principal variation of the last finished iteration.
+     int previousPvLength;                ///< Length of previousPv.
+     bool followPv;                       ///< True while the current path matches previousPv.
+     Move killers[MAX_PLY][2];            ///< Two quiet moves per ply that recently caused a cutoff.
+     int history[2][64][64];              ///< Butterfly history of quiet moves by color, from and to square.
+     Move counterMoves[16][64];           ///< Quiet refutation of a move, by the moved piece's code and destination.
+     Move playedMoves[MAX_PLY];           ///< Move made at each ply of the current path.
+     long long cutNodes;                  ///< Nodes that failed high.
+     long long firstMoveCuts;             ///< Nodes that failed high on the first move searched.
+     SearchShared ownShared;              ///< Shared state used when searching alone.
+     SearchShared* shared;                ///< State shared with the other threads of this search.
+     int threadIndex;                     ///< 0 for the main thread, which enforces the limits.
+ 
+     static const int POLL_INTERVAL = 1024; ///< Most nodes between two polls of the limits.
+ 
+     /**
+      * @brief Checks the stop flag and the main thread's node and time limits.
+      *
+      * The per-node cost is one countdown; only when it runs out does the thread publish its
+      * count and read the clock, the stop flag and the shared node count. Near a node limit
+      * the countdown shortens so the limit is met exactly.
+      * @return True if the search must stop.
+      */
+     bool limitReached() {
+         if (stopped) return true;
+         if (--pollCountdown > 0) return false;
+         pollCountdown = POLL_INTERVAL;
+         shared->nodes.fetch_add(nodes - publishedNodes, memory_order_relaxed);
+         publishedNodes = nodes;
+         if (shared->stop.load(memory_order_relaxed)) stopped = true;
+         else if (threadIndex == 0 && limits.moveTimeMs && !pondering() && elapsedMs() >= limits.moveTimeMs) stopped = true;
+         if (limits.nodes) {
+             long long left = limits.nodes - shared->nodes.load(memory_order_relaxed);
+             if (left <= 0) stopped = true;
+             else if (left < pollCountdown) pollCountdown = (int)left;
+         }
+         return stopped;
+     }
+ 
+     /**
+      * @brief Checks whether the search still runs on the opponent's time.
+      *
+      * Time limits do not apply while pondering. At the ponder hit the clock restarts, so
+      * the search gets its full budget from the moment its own clock starts running.
+      * @return True while pondering.
+      */
+     bool pondering() {
+         if (!ponderActive) return false;
+         if (shared->ponder.load(memory_order_relaxed)) return true;
+         ponderActive = false;
+         start = chrono::steady_clock::now();
+         return false;
+     }
+ 
+     /**
+      * @brief Runs a helper thread's search until the main thread stops it.
+      * @param search The helper's search.
+      */
+     static void runHelper(Search* search) { search->run(); }
+ 
+     /**
+      * @brief Runs a helper thread's share of a root split.
+      * @param search The helper's search.
+      * @param split The shared root moves.
+      * @param depth The iteration's depth.
+      */
+     static void runRootSplit(Search* search, RootSplit* split, int depth) { search->searchRootSplit(split, depth); }
+ 
+     /**
+      * @brief Searches root moves taken from a split, each with a full window, until none are left.
+      * @param split The shared root moves; results are written at the taken indices.
+      * @param depth The iteration's depth.
+      */
+     void searchRootSplit(RootSplit* split, int depth) {
+         for (int i = split->next.fetch_add(1); i < split->moves.size(); i = split->next.fetch_add(1)) {
+             const Move& move = split->moves[i];
+             followPv = false;
+             playedMoves[0] = move;
+             long long nodesBefore = nodes;
+             board.doMove(move);
+             int score = -negamax(depth - 1, 1, -SCORE_INFINITE, SCORE_INFINITE);
+             board.undoMove();
+             rootMoveNodes[move.getFrom()][move.getTo()] += nodes - nodesBefore;
+             if (stopped) break;
+             PvLine& line = split->results[i];
+             line.score = score;
+             line.pv.add(move);
+             for (int j = 0; j < pvLength[1]; j++) line.pv.add(pvTable[1][j]);
+         }
+         // The main thread's limits end the split on every thread.
+         if (stopped && threadIndex == 0) shared->stop.store(true, memory_order_relaxed);
+         shared->nodes.fetch_add(nodes - publishedNodes, memory_order_relaxed);
+         publishedNodes = nodes;
+     }
+ 
+     /**
+      * @brief Makes a line the variation the next search of the root follows first.
+      * @param line The line (nullptr for none).
+      */
+     void followLine(const PvLine* line) {
+         previousPvLength = line ? line->pv.size() : 0;
+         for (int i = 0; i < previousPvLength; i++) previousPv[i] = line->pv[i];
+     }
+ 
+     /**
+      * @brief Runs one iteration and collects its best lines.
+      *
+      * A single line is one root search. Several lines are found one after another, each
+      * search excluding the root moves of the lines before it; with root helpers, the root
+      * moves are instead shared out among the threads, each searched with a full window,
+      * and the best are kept.
+      * @param depth The iteration's depth.
+      * @param rootMoves The legal root moves.
+      * @param lines Receives the lines, best first (those finished if the search stops).
+      */
+     void searchIteration(int depth, const MoveList& rootMoves, vector<PvLine>& lines) {
+         int wanted = limits.multiPv < rootMoves.size() ? limits.multiPv : rootMoves.size();
+         lines.clear();
+         if (wanted > 1 && !rootHelpers.empty()) {
+             RootSplit split;
+             for (size_t i = 0; i < previousLines.size(); i++) split.moves.add(previousLines[i].pv[0]);
+             for (int i = 0; i < rootMoves.size(); i++) {
+                 if (!split.moves.contains(rootMoves[i])) split.moves.add(rootMoves[i]);
+             }
+             split.results.resize(split.moves.size());
+             vector<thread> workers;
+             for (size_t t = 0; t < rootHelpers.size(); t++) workers.push_back(thread(runRootSplit, rootHelpers[t], &split, depth));
+             searchRootSplit(&split, depth);
+             for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+             for (size_t i = 0; i < split.results.size(); i++) {
+                 if (split.results[i].pv.size() > 0) lines.push_back(split.results[i]);
+             }
+             for (size_t i = 1; i < lines.size(); i++) {
+                 for (size_t j = i; j > 0 && lines[j].score > lines[j - 1].score; j--) swap(lines[j], lines[j - 1]);
+             }
+             if ((int)lines.size() > wanted) lines.resize(wanted);
+             // Keep every move's score in order for the next iteration's hand-out.
+             previousLines.clear();
+             for (size_t i = 0; i < split.results.size(); i++) {
+                 if (split.results[i].pv.size() > 0) previousLines.push_back(split.results[i]);
+             }
+             return;
+         }
+         excludedRoot.clear();
+         for (int k = 0; k < wanted; k++) {
+             followLine(k < (int)previousLines.size() ? &previousLines[k] : nullptr);
+             followPv = true;
+             int score = negamax(depth, 0, -SCORE_INFINITE, SCORE_INFINITE);
+             if (stopped || pvLength[0] == 0) break;
+             PvLine line;
+             line.score = score;
+             for (int i = 0; i < pvLength[0]; i++) line.pv.add(pvTable[0][i]);
+             lines.push_back(line);
+             excludedRoot.add(line.pv[0]);
+         }
+         excludedRoot.clear();
+         if (!stopped) previousLines = lines;
+     }
+ 
+     /**
+      * @brief Converts a score to be stored in the table, making mate scores relative to the node.
+      * @param score The score relative to the root.
+      * @param ply Distance from the root.
+      * @return The score to store.
+      */
+     static int scoreToTT(int score, int ply) {
+         if (score > SCORE_MATE - MAX_PLY) return score + ply;
+         if (score < -SCORE_MATE + MAX_PLY) return score - ply;
+         return score;
+     }
+ 
+     /**
+      * @brief Converts a stored score back to be relative to the root.
+      * @param score The stored score.
+      * @param ply Distance from the root.
+      * @return The score relative to the root.
+      */
+     static int scoreFromTT(int score, int ply) {
+         if (score > SCORE_MATE - MAX_PLY) return score - ply;
+         if (score < -SCORE_MATE + MAX_PLY) return score + ply;
+         return score;
+     }
+ 
+     /**
+      * @brief Checks whether a move is quiet (neither a capture nor a promotion).
+      * @param move The move to test.
+      * @return True for quiet moves, the ones killers, history and countermoves apply to.
+      */
+     bool isQuiet(const Move& move) const {
+         return move.getKind() != Move::PROMOTION && move.getKind() != Move::EN_PASSANT
+                && board.getPieceCode(move.getTo()) == NO_PIECE;
+     }
+ 
+     /**
+      * @brief Scores moves for ordering: captures by MVV-LVA, then killers, the countermove
+      *        and the remaining quiet moves by history.
+      * @param moves The moves to score.
+      * @param scores Receives one score per move.
+      * @param first The first index to score.
+      * @param ply Distance from the root.
+      * @param counter The countermove to the previous move (null if none).
+      */
+     void scoreMoves(const MoveList& moves, int* scores, int first, int ply, const Move& counter) const {
+         int us = board.getSideToMove();
+         for (int i = first; i < moves.size(); i++) {
+             const Move& move = moves[i];
+             int attacker = pieceType(board.getPieceCode(move.getFrom()));
+             PieceCode victim = board.getPieceCode(move.getTo());
+             if (move.getKind() == Move::PROMOTION && move.getPromotionType() != ChessPiece::QUEEN_TYPE) {
+                 scores[i] = ORDER_UNDERPROMOTION;
+             } else if (victim != NO_PIECE || move.getKind() == Move::PROMOTION || move.getKind() == Move::EN_PASSANT) {
+                 int victimRank = victim != NO_PIECE ? ORDER_RANK[pieceType(victim)] : 0;
+                 if (move.getKind() == Move::EN_PASSANT) victimRank = ORDER_RANK[ChessPiece::PAWN_TYPE];
+                 if (move.getKind() == Move::PROMOTION) victimRank += ORDER_RANK[ChessPiece::QUEEN_TYPE];
+                 scores[i] = ORDER_CAPTURE + victimRank * 8 - ORDER_RANK[attacker];
+             } else if (move == killers[ply][0]) {
+                 scores[i] = ORDER_KILLER;
+             } else if (move == killers[ply][1]) {
+                 scores[i] = ORDER_KILLER - 1;
+             } else if (move == counter) {
+                 scores[i] = ORDER_COUNTER;
+             } else {
+                 scores[i] = history[us][move.getFrom()][move.getTo()];
+             }
+         }
+     }
+ 
+     /**
+      * @brief Moves the best-scored remaining move to an index, so moves are sorted only as far
+      *        as the search gets before a cutoff.
+      * @param moves The moves.
+      * @param scores Their ordering scores.
+      * @param index The index to fill; moves before it were already searched.
+      */
+     static void pickMove(MoveList& moves, int* scores, int index) {
+         int best = index;
+         for (int i = index + 1; i < moves.size(); i++) {
+             if (scores[i] > scores[best]) best = i;
+         }
+         if (best == index) return;
+         Move move = moves[best];
+         moves[best] = moves[index];
+         moves[index] = move;
+         int score = scores[best];
+         scores[best] = scores[index];
+         scores[index] = score;
+     }
+ 
+     /**
+      * @brief Moves a history score toward a bound, more slowly the closer it already is.
+      * @param entry The history score.
+      * @param bonus Positive to reward the move, negative to penalize it.
+      */
+     static void updateHistory(int& entry, int bonus) {
+         entry += bonus - entry * (bonus < 0 ? -bonus : bonus) / HISTORY_MAX;
+     }
+ 
+     /**
+      * @brief Records a quiet move that failed high, and penalizes the quiet moves tried before it.
+      * @param moves The node's moves; the first count entries were searched, the last of them cut off.
+      * @param count The number of moves searched.
+      * @param depth Remaining depth at the node.
+      * @param ply Distance from the root.
+      */
+     void updateQuietStats(const MoveList& moves, int count, int depth, int ply) {
+         const Move& move = moves[count - 1];
+         int us = board.getSideToMove();
+         int bonus = depth * depth < 400 ? depth * depth : 400;
+         if (killers[ply][0] != move) {
+             killers[ply][1] = killers[ply][0];
+             killers[ply][0] = move;
+         }
+         if (ply > 0) {
+             int previousTo = playedMoves[ply - 1].getTo();
+             counterMoves[board.getPieceCode(previousTo)][previousTo] = move;
+         }
+         updateHistory(history[us][move.getFrom()][move.getTo()], bonus);
+         for (int i = 0; i < count - 1; i++) {
+             if (isQuiet(moves[i])) updateHistory(history[us][moves[i].getFrom()][moves[i].getTo()], -bonus);
+         }
+     }
+ 
+     /**
+      * @brief Searches captures and promotions until the position is quiet.
+      *
+      * The side to move may stand pat on the static evaluation, and captures that lose
+      * material by static exchange evaluation are skipped. In check every evasion is searched,
+      * so mates at the horizon are still found.
+      * @param ply Distance from the root.
+      * @param alpha Lower bound of the window.
+      * @param beta Upper bound of the window.
+      * @return The score from the side to move's point of view.
+      */
+     int quiescence(int ply, int alpha, int beta) {
+         pvLength[ply] = 0;
+         nodes++;
+         if (limitReached()) return 0;
+         if (board.isFiftyMoveDraw() || board.getRepetitionCount() >= 2) return 0;
+         if (ply >= MAX_PLY - 1) return board.evaluate();
+ 
+         bool inCheck = board.isKingInCheck(board.getSideToMove());
+         MoveList moves;
+         if (inCheck) {
+             board.generateLegalMoves(moves);
+             if (moves.size() == 0) return -SCORE_MATE + ply;
+         } else {
+             int standPat = board.evaluate();
+             if (standPat >= beta) return beta;
+             if (standPat > alpha) alpha = standPat;
+             board.generateLegalNoisyMoves(moves);
+         }
+ 
+         int scores[MAX_MOVES];
+         scoreMoves(moves, scores, 0, ply, Move());
+         for (int i = 0; i < moves.size(); i++) {
+             pickMove(moves, scores, i);
+             if (!inCheck && (scores[i] == ORDER_UNDERPROMOTION || board.staticExchange(moves[i]) < 0)) continue;
+             playedMoves[ply] = moves[i];
+             board.doMove(moves[i]);
+             int score = -quiescence(ply + 1, -beta, -alpha);
+             board.undoMove();
+             if (stopped) return 0;
+             if (score > alpha) {
+                 alpha = score;
+                 if (alpha >= beta) break;
+             }
+         }
+         return alpha;
+     }
+ 
+     /**
+      * @brief Searches a position to a fixed depth.
+      * @param depth Remaining depth in plies.
+      * @param ply Distance from the root.
+      * @param alpha Lower bound of the window.
+      * @param beta Upper bound of the window.
+      * @return The score from the side to move's point of view.
+      */
+     int negamax(int depth, int ply, int alpha, int beta) {
+         if (depth == 0) return quiescence(ply, alpha, beta);
+         pvLength[ply] = 0;
+         nodes++;
+         if (limitReached()) return 0;
+         if (ply > 0 && (board.isFiftyMoveDraw() || board.getRepetitionCount() >= 2)) return 0;
+         if (ply >= MAX_PLY - 1) return board.evaluate();
+ 
+         HashKey key = board.getPositionKey();
+         TTEntry entry;
+         Move ttMove;
+         ttProbes++;
+         if (tt.probe(key, entry)) {
+             ttHits++;
+             ttMove = entry.move;
+             if (ply > 0 && entry.depth >= depth) {
+                 int score = scoreFromTT(entry.score, ply);
+                 if (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && score >= beta)
+                     || (entry.bound == BOUND_UPPER && score <= alpha)) {
+                     return score;
+                 }
+             }
+         }
+ 
+         MoveList moves;
+         board.generateLegalMoves(moves);
+         if (moves.size() == 0) return board.isKingInCheck(board.getSideToMove()) ? -SCORE_MATE + ply : 0;
+ 
+         bool onPv = followPv && ply < previousPvLength;
+         followPv = false;
+         Move preferred = onPv ? previousPv[ply] : ttMove;
+         bool preferredFound = false;
+         for (int i = 0; i < moves.size() && !preferred.isNull(); i++) {
+             if (moves[i] == preferred) {
+                 moves[i] = moves[0];
+                 moves[0] = preferred;
+                 preferredFound = true;
+                 break;
+             }
+         }
+         onPv = onPv && preferredFound;
+ 
+         Move counter;
+         if (ply > 0) {
+             int previousTo = playedMoves[ply - 1].getTo();
+             counter = counterMoves[board.getPieceCode(previousTo)][previousTo];
+         }
+         int scores[MAX_MOVES];
+         int first = preferredFound ? 1 : 0;
+         scoreMoves(moves, scores, first, ply, counter);
+ 
+         int alphaOriginal = alpha;
+         Move bestMove;
+         for (int i = 0; i < moves.size(); i++) {
+             if (i >= first) pickMove(moves, scores, i);
+             if (ply == 0 && excludedRoot.contains(moves[i])) continue;
+             followPv = onPv && i == 0;
+             playedMoves[ply] = moves[i];
+             long long nodesBefore = nodes;
+             board.doMove(moves[i]);
+             int score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+             board.undoMove();
+             if (ply == 0) rootMoveNodes[moves[i].getFrom()][moves[i].getTo()] += nodes - nodesBefore;
+             if (stopped) return 0;
+             if (score > alpha) {
+                 alpha = score;
+                 bestMove = moves[i];
+                 pvTable[ply][0] = moves[i];
+                 for (int j = 0; j < pvLength[ply + 1]; j++) pvTable[ply][j + 1] = pvTable[ply + 1][j];
+                 pvLength[ply] = pvLength[ply + 1] + 1;
+                 if (alpha >= beta) {
+                     cutNodes++;
+                     if (i == 0) firstMoveCuts++;
+                     if (isQuiet(moves[i])) updateQuietStats(moves, i + 1, depth, ply);
+                     break;
+                 }
+             }
+         }
+         if (ply == 0 && excludedRoot.size() > 0) return alpha;
+         int bound = alpha >= beta ? BOUND_LOWER : alpha > alphaOriginal ? BOUND_EXACT : BOUND_UPPER;
+         tt.store(key, bestMove, scoreToTT(alpha, ply), depth, bound);
+         return alpha;
+     }
+ 
+ public:
+     /**
+      * @brief Prepares a search of a position.
+      * @param position The position to search (copied).
+      * @param searchLimits When to stop.
+      * @param table The transposition table to use.
+      * @param style What to print after each iteration (INFO_NONE, INFO_CONSOLE or INFO_UCI).
+      * @param sharedState State shared with other threads searching the same root (nullptr if alone).
+      * @param index The thread's index; 0 is the main thread.
+      */
+     Search(const ChessBoard& position, const SearchLimits& searchLimits, TranspositionTable& table, int style,
+            SearchShared* sharedState = nullptr, int index = 0)
+         : board(position), limits(searchLimits), tt(table), ttProbes(0), ttHits(0), infoStyle(style),
+           nodes(0), publishedNodes(0), pollCountdown(1), ponderActive(false), rootMoveNodes(), stopped(false), previousPvLength(0), followPv(false), history(), cutNodes(0), firstMoveCuts(0),
+           shared(sharedState ? sharedState : &ownShared), threadIndex(index) {}
+ 
+     /**
+      * @brief Searches a position with several threads sharing the transposition table.
+      *
+      * Helper threads search without limits until the main thread's search ends, and the
+      * main thread's result is returned with the node count of all threads. When a multi-PV
+      * search wants at least half of the root moves, the helpers instead take root moves
+      * from the main thread in each iteration. Passing a SearchShared lets another thread end
+      * the search early by setting its stop flag.
+      * @param position The position to search.
+      * @param searchLimits Limits for the main thread.
+      * @param table The shared transposition table.
+      * @param threads The number of threads (1 searches on the calling thread only).
+      * @param style What the main thread prints (INFO_NONE, INFO_CONSOLE or INFO_UCI).
+      * @param external Shared state to use, reset by the caller (nullptr for a private one).
+      * @return The main thread's result.
+      */
+     static SearchResult runThreads(const ChessBoard& position, const SearchLimits& searchLimits,
+                                    TranspositionTable& table, int threads, int style,
+                                    SearchShared* external = nullptr) {
+         SearchShared privateState;
+         SearchShared& sharedState = external ? *external : privateState;
+         table.newSearch();
+         MoveList rootMoves;
+         position.generateLegalMoves(rootMoves);
+         // Share out root moves when most of them need an exact score anyway.
+         bool splitRoot = threads > 1 && searchLimits.multiPv > 1 && searchLimits.multiPv * 2 >= rootMoves.size();
+         vector<Search*> helpers;
+         vector<thread> workers;
+         for (int t = 1; t < threads; t++) {
+             helpers.push_back(new Search(position, SearchLimits(), table, INFO_NONE, &sharedState, t));
+             if (!splitRoot) workers.push_back(thread(runHelper, helpers.back()));
+         }
+         Search mainSearch(position, searchLimits, table, style, &sharedState, 0);
+         if (splitRoot) mainSearch.rootHelpers = helpers;
+         SearchResult result = mainSearch.run();
+         sharedState.stop.store(true, memory_order_relaxed);
+         for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+         for (size_t t = 0; t < helpers.size(); t++) delete helpers[t];
+         result.nodes = sharedState.nodes.load(memory_order_relaxed);
+         return result;
+     }
+ 
+     /**
+      * @brief Gets the nodes visited by all threads of this search so far.
+      * @return The node count (exact for this thread, as of their last poll for the others).
+      */
+     long long totalNodes() const { return shared->nodes.load(memory_order_relaxed) + (nodes - publishedNodes); }
+ 
+     /**
+      * @brief Gets the time since the search started.
+      * @return Elapsed milliseconds.
+      */
+     long long elapsedMs() const {
+         return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+     }
+ 
+     /**
+      * @brief Formats a score for display.
+      * @param score A search score.
+      * @return "cp <n>" for ordinary scores, or "mate <n>" with n in moves (negative if being mated).
+      */
+     static string scoreToString(int score) {
+         ostringstream out;
+         if (score > SCORE_MATE - MAX_PLY) out << "mate " << (SCORE_MATE - score + 1) / 2;
+         else if (score < -SCORE_MATE + MAX_PLY) out << "mate " << -(SCORE_MATE + score) / 2;
+         else out << "cp " << score;
+         return out.str();
+     }
+ 
+     /**
+      * @brief Runs iterative deepening until a limit is reached.
+      * @return The result of the deepest finished iteration. If even depth 1 is stopped, depth is 0
+      *         and the move is the best finished line's, or the first legal move.
+      */
+     SearchResult run() {
+         static const int SKIP_SIZE[16] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4};
+         static const int SKIP_PHASE[16] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3};
+         start = chrono::steady_clock::now();
+         ponderActive = shared->ponder.load(memory_order_relaxed);
+         SearchResult result;
+         result.score = 0;
+         result.depth = 0;
+         MoveList rootMoves;
+         board.generateLegalMoves(rootMoves);
+         if (rootMoves.size() > 0) result.bestMove = rootMoves[0];
+ 
+         for (int depth = 1; depth <= limits.depth && rootMoves.size() > 0; depth++) {
+             if (threadIndex > 0) {
+                 if (shared->stop.load(memory_order_relaxed)) break;
+                 // Helpers skip depths in staggered patterns so they do not all repeat the main thread's work.
+                 int pattern = (threadIndex - 1) % 16;
+                 if (depth > 1 && ((depth + SKIP_PHASE[pattern]) / SKIP_SIZE[pattern]) % 2) continue;
+             }
+             vector<PvLine> lines;
+             searchIteration(depth, rootMoves, lines);
+             if (stopped) {
+                 // An interrupted iteration's lines are incomplete; use them only to beat an arbitrary move.
+                 if (result.depth == 0 && !lines.empty()) {
+                     result.score = lines[0].score;
+                     result.pv = lines[0].pv;
+                     result.bestMove = result.pv[0];
+                 }
+                 break;
+             }
+             if (lines.empty()) break;
+             int score = lines[0].score;
+             result.score = score;
+             result.depth = depth;
+             result.pv = lines[0].pv;
+             result.bestMove = result.pv[0];
+             result.lines = lines;
+             for (size_t k = 0; k < lines.size(); k++) {
+                 string multiPv = limits.multiPv > 1 ? " multipv " + to_string(k + 1) : "";
+                 if (infoStyle == INFO_CONSOLE && !pondering()) {
+                     cout << "depth " << depth << multiPv << " score " << scoreToString(lines[k].score)
+                          << " nodes " << totalNodes() << " time " << elapsedMs() << " hashfull " << tt.hashfull()
+                          << " tthits " << (ttProbes ? ttHits * 100 / ttProbes : 0) << "% firstcut "
+                          << (cutNodes ? firstMoveCuts * 100 / cutNodes : 0) << "% pv";
+                     for (int i = 0; i < lines[k].pv.size(); i++) cout << " " << lines[k].pv[i].toString();
+                     cout << "\n";
+                 } else if (infoStyle == INFO_UCI) {
+                     long long ms = elapsedMs();
+                     ostringstream line;
+                     line << "info depth " << depth << multiPv << " score " << scoreToString(lines[k].score)
+                          << " nodes " << totalNodes() << " nps " << totalNodes() * 1000 / (ms > 0 ? ms : 1)
+                          << " time " << ms << " hashfull " << tt.hashfull() << " pv";
+                     for (int i = 0; i < lines[k].pv.size(); i++) line << " " << lines[k].pv[i].toString();
+                     printLine(line.str());
+                 }
+             }
+             if (score > SCORE_MATE - MAX_PLY || score < -SCORE_MATE + MAX_PLY) break;
+             if (threadIndex == 0 && limits.moveTimeMs && !pondering() && elapsedMs() >= limits.moveTimeMs) break;
+             if (threadIndex == 0 && limits.softTimeMs && !pondering()) {
+                 if (rootMoves.size() == 1) break;
+                 Move best = result.bestMove;
+                 int share = (int)(rootMoveNodes[best.getFrom()][best.getTo()] * 1000 / (nodes > 0 ? nodes : 1));
+                 if (timeManager.shouldStop(limits.softTimeMs, elapsedMs(), best, score, share)) break;
+             }
+             if (limitReached()) break;
+         }
+         shared->nodes.fetch_add(nodes - publishedNodes, memory_order_relaxed);
+         publishedNodes = nodes;
+         result.nodes = shared->nodes.load(memory_order_relaxed);
+         return result;
+     }
+ };
+ 
+ /**
+  * @brief Represents a player in the chess game.
+  */
+ class Player {
+ private:
+     string color;          ///< The player's color ("White" or "Black").
+     bool engine;           ///< True if the computer plays this side.
+ 
+ public:
+     /**
+      * @brief Constructs a human Player.
+      * @param col The player's color ("White" or "Black").
+      */
+     Player(string col) : color(col), engine(false) {}
+ 
+     /**
+      * @brief Chooses whether the computer plays this side.
+      * @param isEngine True for the engine, false for a human at the console.
+      */
+     void setEngine(bool isEngine) { engine = isEngine; }
+ 
+     /**
+      * @brief Checks if the computer plays this side.
+      * @return True for the engine, false for a human.
+      */
+     bool isEngine() const { return engine; }
+ 
+     /**
+      * @brief Gets the player's color.
+      * @return The color ("White" or "Black").
+      */
+     string getColor() const { return color; }
+ };
+ 
+ /**
+  * @brief Manages the chess game, including the board and players.
+  */
+ class Game {
+ private:
+     ChessBoard board;        ///< The chessboard.
+     Player whitePlayer;      ///< The white player.
+     Player blackPlayer;      ///< The black player.
+     Player* currentPlayer;   ///< Pointer to the current player.
+     SearchLimits engineLimits; ///< Limits for each engine move.
+     TranspositionTable tt;   ///< Transposition table kept between engine moves.
+     int engineThreads;       ///< Number of threads the engine searches with.
+     bool ponderEnabled;      ///< True to search the expected reply while a human thinks.
+     thread ponderThread;     ///< Background search on the expected position (not joinable when idle).
+     SearchShared ponderShared; ///< Stop and ponder flags of the background search.
+     HashKey ponderKey;       ///< Position key after the expected human move.
+     SearchResult ponderResult; ///< Result of the background search, valid once it is joined.
+ 
+     /**
+      * @brief Runs the background search and keeps its result.
+      * @param game The game.
+      * @param position The position after the expected human move.
+      */
+     static void runPonder(Game* game, ChessBoard position) {
+         game->ponderResult = Search::runThreads(position, game->engineLimits, game->tt, game->engineThreads,
+                                                 INFO_CONSOLE, &game->ponderShared);
      }
  
      /**
-      * @brief Gets the piece at a specific position.
-      * @param x The row index.
-      * @param y The column index.
-      * @return Pointer to the piece at (x, y), or nullptr if empty or out of bounds.
+      * @brief Starts searching the position after the reply the engine expects.
+      * @param expected The engine's last result; its second PV move is the expected reply.
       */
-     ChessPiece* getPieceAt(int x, int y) const {
-         if (x < 0 || x > 7 || y < 0 || y > 7) return nullptr;
-         return squares[x][y].getPiece();
+     void startPondering(const SearchResult& expected) {
+         if (!ponderEnabled || expected.pv.size() < 2) return;
+         ChessBoard position = board;
+         position.doMove(expected.pv[1]);
+         ponderKey = position.getPositionKey();
+         ponderShared.stop.store(false);
+         ponderShared.nodes.store(0);
+         ponderShared.ponder.store(true);
+         ponderThread = thread(runPonder, this, position);
      }
  
      /**
-      * @brief Sets a piece at a specific position on the board.
-      * @param x The row index.
-      * @param y The column index.
-      * @param piece The piece to place (can be nullptr).
+      * @brief Cancels the background search, if any, and waits for it to end.
       */
-     void setPieceAt(int x, int y, ChessPiece* piece) {
-         if (x >= 0 && x < 8 && y >= 0 && y < 8) squares[x][y].setPiece(piece);
+     void stopPondering() {
+         if (!ponderThread.joinable()) return;
+         ponderShared.stop.store(true);
+         ponderThread.join();
      }
  
+ public:
      /**
-      * @brief Checks if a move is valid for a piece (basic validation, e.g., not moving onto same-color piece).
-      * @param piece The piece to move.
-      * @param newX The target row.
-      * @param newY The target column.
-      * @return True if the move is valid, false otherwise.
+      * @brief Constructs a new Game, initializing the board and players.
       */
-     bool isValidMove(ChessPiece* piece, int newX, int newY) const {
-         if (!piece || newX < 0 || newX >= 8 || newY < 0 || newY >= 8) return false;
-         ChessPiece* target = getPieceAt(newX, newY);
-         if (target && target->getColor() == piece->getColor()) return false;
-         return true;
+     Game()
+         : whitePlayer("White"), blackPlayer("Black"), currentPlayer(&whitePlayer), tt(DEFAULT_HASH_MB),
+           engineThreads(1), ponderEnabled(false), ponderKey(0) {
+         board.initializeBoard();
+         engineLimits.moveTimeMs = 1000;
      }
  
      /**
-      * @brief Checks if the king of a given color is in check.
-      * @param color The color of the king to check ("White" or "Black").
-      * @return True if the king is in check, false otherwise.
+      * @brief Constructs a Game starting from a given position.
+      * @param fen The starting position in FEN.
+      * @throws const char* Error message if the FEN is invalid.
       */
-     bool isKingInCheck(const string& color) const {
-         int kingX = -1, kingY = -1;
-         for (int i = 0; i < 8; i++) {
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = getPieceAt(i, j);
-                 if (piece && piece->getColor() == color && piece->getType() == ChessPiece::KING_TYPE) {
-                     kingX = i;
-                     kingY = j;
-                     break;
-                 }
-             }
-             if (kingX != -1) break;
-         }
-         if (kingX == -1) return false;
-         string opponentColor = (color == "White") ? "Black" : "White";
-         for (int i = 0; i < 8; i++) {
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = getPieceAt(i, j);
-                 if (piece && piece->getColor() == opponentColor) {
-                     piece->setPositionForAttack(i, j);
-                     if (piece->canAttack(kingX, kingY, *this)) {
-                         return true;
-                     }
-                 }
-             }
-         }
-         return false;
+     explicit Game(const string& fen)
+         : whitePlayer("White"), blackPlayer("Black"), currentPlayer(&whitePlayer), tt(DEFAULT_HASH_MB),
+           engineThreads(1), ponderEnabled(false), ponderKey(0) {
+         if (!board.loadFEN(fen)) throw "Invalid FEN";
+         if (board.getSideToMove() == COLOR_BLACK) currentPlayer = &blackPlayer;
+         engineLimits.moveTimeMs = 1000;
      }
  
      /**
-      * @brief Checks if a square is under attack by a given color.
-      * @param x The row of the square.
-      * @param y The column of the square.
-      * @param attackerColor The color of the attacking pieces ("White" or "Black").
-      * @return True if the square is under attack, false otherwise.
+      * @brief Chooses which sides the engine plays and how long it thinks.
+      * @param whiteEngine True if the engine plays White.
+      * @param blackEngine True if the engine plays Black.
+      * @param limits Search limits for each engine move.
       */
-     bool isSquareUnderAttack(int x, int y, const string& attackerColor) const {
-         for (int i = 0; i < 8; i++) {
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = getPieceAt(i, j);
-                 if (piece && piece->getColor() == attackerColor) {
-                     piece->setPositionForAttack(i, j);
-                     if (piece->canAttack(x, y, *this)) return true;
+     void setEngines(bool whiteEngine, bool blackEngine, const SearchLimits& limits) {
+         whitePlayer.setEngine(whiteEngine);
+         blackPlayer.setEngine(blackEngine);
+         engineLimits = limits;
+     }
+ 
+     /**
+      * @brief Resizes the engine's transposition table.
+      * @param megabytes The new size in MB.
+      */
+     void setHashSize(size_t megabytes) { tt.resize(megabytes); }
+ 
+     /**
+      * @brief Sets how many threads the engine searches with.
+      * @param threads The thread count (at least 1).
+      */
+     void setThreads(int threads) { engineThreads = threads < 1 ? 1 : threads; }
+ 
+     /**
+      * @brief Chooses whether the engine thinks on the human's time.
+      * @param enabled True to ponder the reply the engine expects.
+      */
+     void setPonder(bool enabled) { ponderEnabled = enabled; }
+ 
+     /**
+      * @brief Stops any background search still running.
+      */
+     ~Game() { stopPondering(); }
+ 
+     /**
+      * @brief Starts and runs the chess game loop.
+      *
+      * With pondering on, the engine searches the position after the human's expected reply
+      * on a background thread while the console waits for input. If the human plays that
+      * move, the search carries on with its normal time budget from then on; otherwise it
+      * is cancelled, and its transposition table entries remain for the new search.
+      */
+     void startGame() {
+         bool gameOver = false;
+         while (!gameOver) {
+             board.display();
+             if (currentPlayer->isEngine()) {
+                 SearchResult result;
+                 if (ponderThread.joinable()) {
+                     cout << currentPlayer->getColor() << " is thinking (ponder hit)...\n";
+                     ponderShared.ponder.store(false);
+                     ponderThread.join();
+                     result = ponderResult;
+                 } else {
+                     cout << currentPlayer->getColor() << " is thinking...\n";
+                     result = Search::runThreads(board, engineLimits, tt, engineThreads, INFO_CONSOLE);
                  }
+                 if (result.bestMove.isNull()) break;
+                 cout << currentPlayer->getColor() << " plays " << result.bestMove.toString() << "\n";
+                 board.doMove(result.bestMove);
+                 gameOver = finishTurn();
+                 if (!gameOver && !currentPlayer->isEngine()) startPondering(result);
+                 continue;
+             }
+             cout << currentPlayer->getColor() << "'s turn. Enter move (e.g., e2 e4, O-O, O-O-O), 'fen' or 'resign': ";
+             string input;
+             if (!(cin >> input)) break;
+             if (input == "fen") {
+                 cout << board.toFEN() << "\n";
+                 continue;
+             }
+             if (input == "resign") {
+                 cout << currentPlayer->getColor() << " resigns. "
+                      << (currentPlayer == &whitePlayer ? "Black" : "White") << " wins!\n";
+                 gameOver = true;
+                 break;
+             }
+             string from, to;
+             if (input == "O-O") {
+                 from = (currentPlayer->getColor() == "White") ? "e1" : "e8";
+                 to = (currentPlayer->getColor() == "White") ? "g1" : "g8";
+             } else if (input == "O-O-O") {
+                 from = (currentPlayer->getColor() == "White") ? "e1" : "e8";
+                 to = (currentPlayer->getColor() == "White") ? "c1" : "c8";
+             } else {
+                 from = input;
+                 cin >> to;
+             }
+             Position fromPos = algebraicToIndices(from);
+             Position toPos = algebraicToIndices(to);
+             if (fromPos.getRow() == -1 || toPos.getRow() == -1) {
+                 cout << "Invalid position format\n";
+                 continue;
+             }
+             Move move(fromPos.getRow(), fromPos.getCol(), toPos.getRow(), toPos.getCol());
+             try {
+                 makeMove(move);
+                 if (ponderThread.joinable() && board.getPositionKey() != ponderKey) stopPondering();
+                 gameOver = finishTurn();
+             } catch (const char* error) {
+                 cout << "Error: " << error << "\n";
              }
          }
-         return false;
+         stopPondering();
      }
  
      /**
-      * @brief Checks if a player can castle.
-      * @param color The player's color ("White" or "Black").
-      * @param kingside True for kingside castling, false for queenside.
-      * @return True if castling is possible, false otherwise.
+      * @brief Reports check and the end of the game after a move, or passes the turn on.
+      * @return True if the game is over.
       */
-     bool canCastle(const string& color, bool kingside) const {
-         int kingX = (color == "White") ? 7 : 0;
-         int kingY = 4;
-         int rookY = kingside ? 7 : 0;
-         ChessPiece* king = getPieceAt(kingX, kingY);
-         ChessPiece* rook = getPieceAt(kingX, rookY);
-         if (!king || king->getType() != ChessPiece::KING_TYPE || king->getHasMoved()) return false;
-         if (!rook || rook->getType() != ChessPiece::ROOK_TYPE || rook->getHasMoved()) return false;
-         if (isKingInCheck(color)) return false;
-         int yStart = kingside ? 5 : 1;
-         int yEnd = kingside ? 7 : 0;
-         int yStep = kingside ? 1 : -1;
-         for (int y = yStart; y != yEnd; y += yStep) {
-             if (getPieceAt(kingX, y)) return false;
-         }
-         string opponentColor = (color == "White") ? "Black" : "White";
-         int checkYStart = kingY;
-         int checkYEnd = kingside ? kingY + 2 : kingY - 2;
-         int checkYStep = kingside ? 1 : -1;
-         for (int y = checkYStart; y != checkYEnd + checkYStep; y += checkYStep) {
-             if (isSquareUnderAttack(kingX, y, opponentColor)) return false;
+     bool finishTurn() {
+         string opponentColor = (currentPlayer == &whitePlayer) ? "Black" : "White";
+         if (board.isKingInCheck(opponentColor)) {
+             cout << opponentColor << " is in check!\n";
          }
-         return true;
+         int state = board.isGameOver(opponentColor);
+         if (state == GAME_CHECKMATE) {
+             board.display();
+             cout << "Checkmate! " << currentPlayer->getColor() << " wins!\n";
+             return true;
+         } else if (state == GAME_STALEMATE) {
+             board.display();
+             cout << "Stalemate! The game is a draw.\n";
+             return true;
+         } else if (board.isFiftyMoveDraw()) {
+             board.display();
+             cout << "Draw by 50-move rule!\n";
+             return true;
+         } else if (board.isThreefoldRepetition()) {
+             board.display();
+             cout << "Draw by threefold repetition!\n";
+             return true;
+         }
+         switchPlayer();
+         return false;
      }
  
      /**
-      * @brief Determines if the game is over for a player.
-      * @param color The player's color ("White" or "Black").
-      * @return GAME_NONE if the game continues, GAME_CHECKMATE if checkmate, or GAME_STALEMATE if stalemate.
+      * @brief Executes a move for the current player.
+      *
+      * The move is checked against the board's legal move generator; only its starting and
+      * ending squares are used, and the player is asked for the piece when a pawn promotes.
+      * @param move The move to execute.
+      * @throws const char* Error message if the move is invalid.
       */
-     int isGameOver(const string& color) {
-         bool inCheck = isKingInCheck(color);
-         bool hasLegalMove = false;
+     void makeMove(const Move& move) {
+         int fromX = move.getFromX();
+         int fromY = move.getFromY();
+         int toX = move.getToX();
+         int toY = move.getToY();
  
-         for (int i = 0; i < 8; i++) {
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = getPieceAt(i, j);
-                 if (piece && piece->getColor() == color) {
-                     int origX = piece->getX();
-                     int origY = piece->getY();
-                     for (int newX = 0; newX < 8; newX++) {
-                         for (int newY = 0; newY < 8; newY++) {
-                             bool needsPromotion = false;
-                             if (isValidMove(piece, newX, newY)) {
-                                 ChessPiece* target = getPieceAt(newX, newY);
-                                 bool canMove = piece->move(newX, newY, *this, needsPromotion);
-                                 if (canMove) {
-                                     setPieceAt(newX, newY, piece);
-                                     setPieceAt(origX, origY, nullptr);
-                                     ChessPiece* promotedPiece = nullptr;
-                                     if (needsPromotion) {
-                                         promotedPiece = new Queen(piece->getColor(), newX, newY);
-                                         setPieceAt(newX, newY, promotedPiece);
-                                     }
-                                     bool stillInCheck = isKingInCheck(color);
-                                     setPieceAt(origX, origY, piece);
-                                     setPieceAt(newX, newY, target);
-                                     if (promotedPiece) {
-                                         setPieceAt(newX, newY, target);
-                                         delete promotedPiece;
-                                     }
-                                     piece->setPosition(origX, origY);
-                                     if (!stillInCheck) {
-                                         hasLegalMove = true;
-                                         break;
-                                     }
-                                 }
-                             }
-                         }
-                         if (hasLegalMove) break;
-                     }
-                     if (hasLegalMove) break;
+         const ChessPiece* piece = board.getPieceAt(fromX, fromY);
+         if (!piece) throw "No piece at starting position";
+         if (piece->getColor() != currentPlayer->getColor()) throw "Not your piece";
+ 
+         MoveList legalMoves;
+         board.generateLegalMoves(piece->getColorIndex(), legalMoves);
+         Move chosen;
+         bool found = false;
+         for (int i = 0; i < legalMoves.size() && !found; i++) {
+             if (legalMoves[i].getFrom() == move.getFrom() && legalMoves[i].getTo() == move.getTo()) {
+                 chosen = legalMoves[i];
+                 found = true;
+             }
+         }
+         if (!found) {
+             MoveList pseudoMoves;
+             board.generatePseudoLegalMoves(piece->getColorIndex(), pseudoMoves);
+             for (int i = 0; i < pseudoMoves.size(); i++) {
+                 if (pseudoMoves[i].getFrom() == move.getFrom() && pseudoMoves[i].getTo() == move.getTo()) {
+                     throw "Move puts your king in check";
                  }
              }
-             if (hasLegalMove) break;
+             throw "Invalid move";
+         }
+ 
+         if (chosen.getKind() == Move::PROMOTION) {
+             string pieceType;
+             cout << "Pawn promotion! Choose piece (Queen, Rook, Bishop, Knight): ";
+             cin >> pieceType;
+             pieceType = toTitleCase(pieceType);
+             int type;
+             if (pieceType == "Queen") type = ChessPiece::QUEEN_TYPE;
+             else if (pieceType == "Rook") type = ChessPiece::ROOK_TYPE;
+             else if (pieceType == "Bishop") type = ChessPiece::BISHOP_TYPE;
+             else if (pieceType == "Knight") type = ChessPiece::KNIGHT_TYPE;
+             else throw "Invalid promotion piece";
+             chosen = Move(fromX, fromY, toX, toY, Move::PROMOTION, type);
          }
  
-         if (hasLegalMove) return GAME_NONE;
-         return inCheck ? GAME_CHECKMATE : GAME_STALEMATE;
+         board.doMove(chosen);
      }
  
      /**
-      * @brief Promotes a pawn to a new piece type.
-      * @param x The row of the pawn.
-      * @param y The column of the pawn.
-      * @param pieceType The type to promote to ("Queen", "Rook", "Bishop", "Knight").
-      * @param color The color of the pawn.
-      * @return Pointer to the new piece, or nullptr if promotion fails.
+      * @brief Switches the current player to the opponent.
       */
-     ChessPiece* promotePawn(int x, int y, const string& pieceType, const string& color) {
-         ChessPiece* piece = getPieceAt(x, y);
-         if (!piece || piece->getType() != ChessPiece::PAWN_TYPE) return nullptr;
-         ChessPiece* newPiece = nullptr;
-         if (pieceType == "Queen") newPiece = new Queen(color, x, y);
-         else if (pieceType == "Rook") newPiece = new Rook(color, x, y);
-         else if (pieceType == "Bishop") newPiece = new Bishop(color, x, y);
-         else if (pieceType == "Knight") newPiece = new Knight(color, x, y);
-         if (newPiece) setPieceAt(x, y, newPiece);
-         return newPiece;
+     void switchPlayer() {
+         currentPlayer = (currentPlayer == &whitePlayer) ? &blackPlayer : &whitePlayer;
      }
+ };
+ 
+ /**
+  * @brief Speaks the Universal Chess Interface over standard input and output.
+  *
+  * The calling thread reads commands while searches run on a thread of their own, so
+  * "stop" and "isready" are answered during a search; stop sets the flag every search
+  * thread polls each 1024 nodes. "go ponder" searches without time limits until
+  * "ponderhit" starts the clock or "stop" ends it. Info and bestmove lines go through printLine.
+  */
+ class UciEngine {
+ private:
+     ChessBoard board;          ///< Position set by the last "position" command.
+     TranspositionTable tt;     ///< Transposition table kept between searches.
+     int threads;               ///< Number of search threads (the Threads option).
+     int multiPv;               ///< Number of lines to report (the MultiPV option).
+     SearchShared shared;       ///< Stop flag and node count of the running search.
+     atomic<bool> stopRequested; ///< Set by "stop" or "quit"; an infinite search waits for it.
+     thread searchThread;       ///< Thread running the current search (not joinable when idle).
  
      /**
-      * @brief Checks if the game is a draw by the 50-move rule.
-      * @return True if 50 moves have passed without a capture or pawn move, false otherwise.
+      * @brief Runs one search and reports its best move.
+      * @param engine The engine.
+      * @param position The position to search.
+      * @param limits Limits for the search.
+      * @param infinite True if bestmove must wait for "stop" even if the search ends first (it
+      *        also waits while pondering, for "ponderhit" or "stop").
       */
-     bool isFiftyMoveDraw() const { return halfMoveClock >= 100; }
+     static void runSearch(UciEngine* engine, ChessBoard position, SearchLimits limits, bool infinite) {
+         SearchResult result = Search::runThreads(position, limits, engine->tt, engine->threads, INFO_UCI, &engine->shared);
+         while ((infinite || engine->shared.ponder.load()) && !engine->stopRequested.load()) {
+             this_thread::sleep_for(chrono::milliseconds(1));
+         }
+         printLine("bestmove " + (result.bestMove.isNull() ? string("0000") : result.bestMove.toString()));
+     }
  
      /**
-      * @brief Checks if the game is a draw by threefold repetition.
-      * @return True if the same position has occurred three times, false otherwise.
+      * @brief Stops the running search, if any, and waits for its bestmove.
       */
-     bool isThreefoldRepetition() const {
-         if (positionCount == 0) return false;
-         string current = positionHistory[positionCount - 1];
-         int count = 0;
-         for (int i = 0; i < positionCount; i++) {
-             if (positionHistory[i] == current) count++;
-         }
-         return count >= 3;
+     void stopSearch() {
+         if (!searchThread.joinable()) return;
+         stopRequested.store(true);
+         shared.stop.store(true);
+         searchThread.join();
      }
  
      /**
-      * @brief Updates the move history for draw rules and en passant.
-      * @param fromX The starting row.
-      * @param fromY The starting column.
-      * @param toX The ending row.
-      * @param toY The ending column.
-      * @param piece The piece that moved.
-      * @param isCapture True if the move was a capture, false otherwise.
+      * @brief Handles "position [startpos | fen <FEN>] [moves <move>...]".
+      * @param in The rest of the command.
       */
-     void updateMoveHistory(int fromX, int fromY, int toX, int toY, ChessPiece* piece, bool isCapture) {
-         lastMoveFromX = fromX;
-         lastMoveFromY = fromY;
-         lastMoveToX = toX;
-         lastMoveToY = toY;
-         lastMoveWasPawnTwoSquares = false;
-         if (piece) {
-             if (piece->getType() == ChessPiece::PAWN_TYPE) {
-                 int diff = toX - fromX;
-                 if ((diff == 2 || diff == -2) && fromY == toY) lastMoveWasPawnTwoSquares = true;
+     void setPosition(istringstream& in) {
+         string token, fen;
+         in >> token;
+         if (token == "startpos") {
+             board = ChessBoard();
+             board.initializeBoard();
+             in >> token;
+         } else if (token == "fen") {
+             while (in >> token && token != "moves") fen += token + " ";
+             if (!board.loadFEN(fen)) {
+                 printLine("info string invalid FEN");
+                 board = ChessBoard();
+                 board.initializeBoard();
+                 return;
+             }
+         }
+         if (token != "moves") return;
+         while (in >> token) {
+             MoveList moves;
+             board.generateLegalMoves(moves);
+             bool found = false;
+             for (int i = 0; i < moves.size() && !found; i++) {
+                 if (moves[i].toString() == token) {
+                     board.doMove(moves[i]);
+                     found = true;
+                 }
+             }
+             if (!found) {
+                 printLine("info string illegal move " + token);
+                 return;
              }
-             halfMoveClock++;
-             if (isCapture || piece->getType() == ChessPiece::PAWN_TYPE) halfMoveClock = 0;
-         } else {
-             halfMoveClock++;
-             if (isCapture) halfMoveClock = 0;
          }
-         if (positionCount < 1000) positionHistory[positionCount++] = getPositionHash();
      }
  
      /**
-      * @brief Converts board indices to algebraic notation.
-      * @param x The row index.
-      * @param y The column index.
-      * @return The position in algebraic notation (e.g., "e4").
+      * @brief Handles "go" and starts the search thread.
+      *
+      * With wtime/btime the TimeManager sets the soft target and hard cap; movetime is a fixed
+      * budget used in full.
+      * @param in The rest of the command.
       */
-     string algebraicFromIndices(int x, int y) const {
-         string pos;
-         pos += char('a' + y);
-         pos += char('8' - x);
-         return pos;
+     void go(istringstream& in) {
+         stopSearch();
+         SearchLimits limits;
+         bool infinite = false;
+         long long time[2] = {-1, -1}, increment[2] = {0, 0};
+         int movesToGo = 0;
+         bool ponder = false;
+         limits.multiPv = multiPv;
+         string token;
+         while (in >> token) {
+             if (token == "depth") in >> limits.depth;
+             else if (token == "ponder") ponder = true;
+             else if (token == "nodes") in >> limits.nodes;
+             else if (token == "movetime") in >> limits.moveTimeMs;
+             else if (token == "wtime") in >> time[COLOR_WHITE];
+             else if (token == "btime") in >> time[COLOR_BLACK];
+             else if (token == "winc") in >> increment[COLOR_WHITE];
+             else if (token == "binc") in >> increment[COLOR_BLACK];
+             else if (token == "movestogo") in >> movesToGo;
+             else if (token == "infinite") infinite = true;
+         }
+         if (limits.depth < 1 || limits.depth >= MAX_PLY) limits.depth = MAX_PLY - 1;
+         int us = board.getSideToMove();
+         if (time[us] >= 0 && !limits.moveTimeMs) TimeManager::allocate(limits, time[us], increment[us], movesToGo);
+         shared.stop.store(false);
+         shared.nodes.store(0);
+         shared.ponder.store(ponder);
+         stopRequested.store(false);
+         searchThread = thread(runSearch, this, board, limits, infinite);
      }
  
      /**
-      * @brief Gets the row of the last move's ending position.
-      * @return The row index.
+      * @brief Handles "setoption name <Hash|Threads|MultiPV|Ponder> value <n>".
+      * @param in The rest of the command.
       */
-     int getLastMoveToX() const { return lastMoveToX; }
+     void setOption(istringstream& in) {
+         string token, name, value;
+         in >> token;
+         while (in >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+         in >> value;
+         if (name == "Hash") {
+             int megabytes = atoi(value.c_str());
+             tt.resize(megabytes < 1 ? 1 : megabytes);
+         } else if (name == "Threads") {
+             threads = atoi(value.c_str());
+             if (threads < 1) threads = 1;
+         } else if (name == "MultiPV") {
+             multiPv = atoi(value.c_str());
+             if (multiPv < 1) multiPv = 1;
+         } else if (name != "Ponder") {
+             printLine("info string unknown option " + name);
+         }
+     }
  
+ public:
      /**
-      * @brief Gets the row of the last move's starting position.
-      * @return The row index.
+      * @brief Constructs the engine on the initial position.
+      * @param hashMB Initial transposition table size in megabytes.
+      * @param threadCount Initial number of search threads.
       */
-     int getLastMoveFromX() const { return lastMoveFromX; }
- };
- 
- /**
-  * @brief Represents a chess move from one position to another.
-  */
- class Move {
- private:
-     int fromX, fromY; ///< Starting position (row, col).
-     int toX, toY;     ///< Ending position (row, col).
+     UciEngine(size_t hashMB, int threadCount)
+         : tt(hashMB), threads(threadCount < 1 ? 1 : threadCount), multiPv(1), stopRequested(false) {
+         board.initializeBoard();
+     }
  
- public:
      /**
-      * @brief Constructs a Move.
-      * @param fx Starting row.
-      * @param fy Starting column.
-      * @param tx Ending row.
-      * @param ty Ending column.
+      * @brief Stops any search still running.
       */
-     Move(int fx, int fy, int tx, int ty) : fromX(fx), fromY(fy), toX(tx), toY(ty) {}
+     ~UciEngine() { stopSearch(); }
  
      /**
-      * @brief Gets the starting row.
-      * @return The starting row index.
+      * @brief Reads and answers commands until "quit" or the end of input.
       */
-     int getFromX() const { return fromX; }
+     void loop() {
+         string line;
+         while (getline(cin, line)) {
+             istringstream in(line);
+             string command;
+             in >> command;
+             if (command == "uci") {
+                 printLine("id name latest_chess");
+                 printLine("id author Saad Mehmood Athar");
+                 printLine("option name Hash type spin default " + to_string(tt.sizeMB()) + " min 1 max 65536");
+                 printLine("option name Threads type spin default " + to_string(threads) + " min 1 max 512");
+                 printLine("option name Ponder type check default false");
+                 printLine("option name MultiPV type spin default 1 min 1 max " + to_string(MAX_MOVES));
+                 printLine("uciok");
+             } else if (command == "isready") {
+                 printLine("readyok");
+             } else if (command == "ucinewgame") {
+                 stopSearch();
+                 tt.clear();
+             } else if (command == "setoption") {
+                 stopSearch();
+                 setOption(in);
+             } else if (command == "position") {
+                 stopSearch();
+                 setPosition(in);
+             } else if (command == "go") {
+                 go(in);
+             } else if (command == "ponderhit") {
+                 shared.ponder.store(false);
+             } else if (command == "stop") {
+                 stopSearch();
+             } else if (command == "quit") {
+                 break;
+             } else if (command == "d") {
+                 printLine(board.toFEN());
+             } else if (!command.empty()) {
+                 printLine("info string unknown command " + command);
+             }
+         }
+         stopSearch();
+     }
+ };
+ 
+ /**
+  * @brief A reference position with its known perft node counts.
+  */
+ struct PerftPosition {
+     const char* name;            ///< Common name of the position.
+     const char* fen;             ///< The position in FEN.
+     long long expected[7];       ///< Node counts for depths 1 to 7 (0 where unknown).
+ };
+ 
+ /**
+  * @brief The standard perft reference positions (chessprogramming.org "Perft Results").
+  */
+ const PerftPosition PERFT_POSITIONS[] = {
+     {"Initial", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      {20, 400, 8902, 197281, 4865609, 119060324, 3195901860LL}},
+     {"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      {48, 2039, 97862, 4085603, 193690690, 8031647685LL, 0}},
+     {"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      {14, 191, 2812, 43238, 674624, 11030083, 178633661}},
+     {"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      {6, 264, 9467, 422333, 15833292, 706045033, 0}},
+     {"Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      {44, 1486, 62379, 2103487, 89941194, 0, 0}},
+     {"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+      {46, 2079, 89890, 3894594, 164075551, 6923051137LL, 0}}
+ };
+ 
+ const int PERFT_POSITION_COUNT = sizeof(PERFT_POSITIONS) / sizeof(PERFT_POSITIONS[0]); ///< Number of reference positions.
+ 
+ /**
+  * @brief Malformed or impossible positions that ChessBoard::loadFEN must reject.
+  */
+ const char* const INVALID_FENS[] = {
+     "pppppppppppppppp/8/8/8/8/8/4K2k w - - 0 1",           // Seven ranks, one sixteen files wide.
+     "4k3/8/8/8/8/8/8/4K2k w - - 0 1",                      // Two black kings.
+     "P3k3/8/8/8/8/8/8/4K3 w - - 0 1",                      // White pawn on the eighth rank.
+     "4k3/8/8/8/8/8/8/p3K3 b - - 0 1",                      // Black pawn on the first rank.
+     "4k3/8/8/8/8/8/8/4R1K1 w - - 0 1",                     // Black, not to move, is in check.
+     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 junk" // Text after the counters.
+ };
+ 
+ const int INVALID_FEN_COUNT = sizeof(INVALID_FENS) / sizeof(INVALID_FENS[0]); ///< Number of rejected positions.
  
+ /**
+  * @brief Counts leaf nodes of the legal move tree, for validating move generation and measuring its speed.
+  */
+ class Perft {
+ public:
      /**
-      * @brief Gets the starting column.
-      * @return The starting column index.
+      * @brief Counts the leaf nodes reachable in exactly depth plies.
+      * @param board The position to start from (restored on return).
+      * @param depth The number of plies.
+      * @return The number of leaf nodes.
       */
-     int getFromY() const { return fromY; }
+     static long long count(ChessBoard& board, int depth) {
+         if (depth == 0) return 1;
+         MoveList moves;
+         board.generateLegalMoves(moves);
+         if (depth == 1) return moves.size();
+         long long nodes = 0;
+         for (int i = 0; i < moves.size(); i++) {
+             board.doMove(moves[i]);
+             nodes += count(board, depth - 1);
+             board.undoMove();
+         }
+         return nodes;
+     }
  
      /**
-      * @brief Gets the ending row.
-      * @return The ending row index.
+      * @brief Counts leaf nodes using several threads, each walking subtrees on its own board copy.
+      *
+      * The tree is split after the first two plies (or one ply at depth 2) so that there are
+      * many more tasks than threads. Threads pull tasks from a shared counter and write each
+      * result into its own slot, and the slots are summed in move order afterwards, so the
+      * totals do not depend on scheduling.
+      * @param board The position to start from.
+      * @param depth The number of plies.
+      * @param threads The number of worker threads.
+      * @param rootMoves Output: the legal moves at the root.
+      * @param rootCounts Output: the node count below each root move.
+      * @return The number of leaf nodes.
       */
-     int getToX() const { return toX; }
+     static long long countParallel(const ChessBoard& board, int depth, int threads,
+                                    MoveList& rootMoves, vector<long long>& rootCounts) {
+         ChessBoard root(board);
+         root.generateLegalMoves(rootMoves);
+         rootCounts.assign(rootMoves.size(), depth == 1 ? 1 : 0);
+         if (depth <= 1) return depth == 1 ? rootMoves.size() : 1;
+ 
+         PerftJob job(depth);
+         for (int i = 0; i < rootMoves.size(); i++) {
+             if (depth == 2) {
+                 job.tasks.push_back(PerftTask(i, rootMoves[i], Move()));
+                 continue;
+             }
+             root.doMove(rootMoves[i]);
+             MoveList replies;
+             root.generateLegalMoves(replies);
+             for (int j = 0; j < replies.size(); j++) job.tasks.push_back(PerftTask(i, rootMoves[i], replies[j]));
+             root.undoMove();
+         }
+         job.counts.assign(job.tasks.size(), 0);
+ 
+         vector<thread> workers;
+         for (int t = 1; t < threads; t++) workers.push_back(thread(runTasks, cref(board), ref(job)));
+         runTasks(board, job);
+         for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+ 
+         long long nodes = 0;
+         for (size_t k = 0; k < job.tasks.size(); k++) {
+             rootCounts[job.tasks[k].rootIndex] += job.counts[k];
+             nodes += job.counts[k];
+         }
+         return nodes;
+     }
  
      /**
-      * @brief Gets the ending column.
-      * @return The ending column index.
+      * @brief Runs perft and prints nodes, elapsed time and nodes per second.
+      * @param board The position to start from.
+      * @param depth The number of plies.
+      * @param divide True to also print the node count below each root move.
+      * @param threads The number of worker threads.
+      * @return The total number of leaf nodes.
       */
-     int getToY() const { return toY; }
- };
- 
- /**
-  * @brief Represents a player in the chess game.
-  */
- class Player {
- private:
-     string color;          ///< The player's color ("White" or "Black").
-     ChessPiece* pieces[16];///< Array of the player's pieces.
-     int pieceCount;        ///< Number of pieces the player has.
+     static long long run(ChessBoard& board, int depth, bool divide, int threads) {
+         chrono::steady_clock::time_point start = chrono::steady_clock::now();
+         MoveList moves;
+         vector<long long> rootCounts;
+         long long nodes = countParallel(board, depth, threads, moves, rootCounts);
+         if (divide && depth > 0) {
+             for (int i = 0; i < moves.size(); i++) cout << moves[i].toString() << ": " << rootCounts[i] << "\n";
+             cout << "\n";
+         }
+         report(nodes, start);
+         return nodes;
+     }
  
- public:
      /**
-      * @brief Constructs a Player.
-      * @param col The player's color ("White" or "Black").
+      * @brief Runs every reference position and compares against the known counts, then checks
+      *        that every INVALID_FENS entry is rejected.
+      * @param maxDepth The deepest depth to run for each position.
+      * @param threads The number of worker threads.
+      * @return True if every count matched and every invalid FEN was rejected.
       */
-     Player(string col) : color(col), pieceCount(0) {
-         for (int i = 0; i < 16; i++) pieces[i] = nullptr;
+     static bool runSuite(int maxDepth, int threads) {
+         bool allPassed = true;
+         long long totalNodes = 0;
+         chrono::steady_clock::time_point start = chrono::steady_clock::now();
+         for (int p = 0; p < PERFT_POSITION_COUNT; p++) {
+             const PerftPosition& position = PERFT_POSITIONS[p];
+             ChessBoard board;
+             board.loadFEN(position.fen);
+             for (int depth = 1; depth <= maxDepth && depth <= 7 && position.expected[depth - 1] > 0; depth++) {
+                 MoveList rootMoves;
+                 vector<long long> rootCounts;
+                 long long nodes = countParallel(board, depth, threads, rootMoves, rootCounts);
+                 totalNodes += nodes;
+                 bool passed = nodes == position.expected[depth - 1];
+                 cout << position.name << " depth " << depth << ": " << nodes
+                      << (passed ? " ok" : " MISMATCH") << "\n";
+                 if (!passed) {
+                     cerr << "perft mismatch in " << position.name << " at depth " << depth << ": expected "
+                          << position.expected[depth - 1] << ", got " << nodes << "\n";
+                     allPassed = false;
+                 }
+             }
+         }
+         for (int f = 0; f < INVALID_FEN_COUNT; f++) {
+             ChessBoard board;
+             if (board.loadFEN(INVALID_FENS[f])) {
+                 cerr << "invalid FEN accepted: " << INVALID_FENS[f] << "\n";
+                 allPassed = false;
+             }
+         }
+         report(totalNodes, start);
+         cout << (allPassed ? "All perft counts match.\n" : "PERFT FAILED\n");
+         return allPassed;
      }
  
+ private:
      /**
-      * @brief Destroys the Player.
+      * @brief A subtree to count: a root move and, below depth 2, one reply to it.
       */
-     ~Player() {}
+     struct PerftTask {
+         int rootIndex; ///< Index of the root move in the root move list.
+         Move rootMove; ///< The root move.
+         Move reply;    ///< The reply to play after it (null when splitting at the root only).
+ 
+         PerftTask(int index, const Move& first, const Move& second)
+             : rootIndex(index), rootMove(first), reply(second) {}
+     };
  
      /**
-      * @brief Adds a piece to the player's collection.
-      * @param piece The piece to add.
+      * @brief Work shared by the perft threads.
       */
-     void addPiece(ChessPiece* piece) {
-         if (piece && pieceCount < 16) pieces[pieceCount++] = piece;
-     }
+     struct PerftJob {
+         int depth;                 ///< Total perft depth.
+         vector<PerftTask> tasks;   ///< Subtrees to count.
+         vector<long long> counts;  ///< Result per task, written only by the thread that ran it.
+         atomic<int> nextTask;      ///< Index of the next unclaimed task.
+ 
+         explicit PerftJob(int d) : depth(d), nextTask(0) {}
+     };
  
      /**
-      * @brief Removes a piece from the player's collection.
-      * @param piece The piece to remove.
+      * @brief Worker loop: claims tasks until none are left and counts them on a private board.
+      * @param board The root position (only read, then copied).
+      * @param job The shared work.
       */
-     void removePiece(ChessPiece* piece) {
-         for (int i = 0; i < pieceCount; i++) {
-             if (pieces[i] == piece) {
-                 for (int j = i; j < pieceCount - 1; j++) pieces[j] = pieces[j + 1];
-                 pieces[pieceCount - 1] = nullptr;
-                 pieceCount--;
-                 break;
+     static void runTasks(const ChessBoard& board, PerftJob& job) {
+         ChessBoard local(board);
+         int taskCount = (int)job.tasks.size();
+         for (int k = job.nextTask++; k < taskCount; k = job.nextTask++) {
+             const PerftTask& task = job.tasks[k];
+             local.doMove(task.rootMove);
+             if (task.reply.isNull()) {
+                 job.counts[k] = count(local, job.depth - 1);
+             } else {
+                 local.doMove(task.reply);
+                 job.counts[k] = count(local, job.depth - 2);
+                 local.undoMove();
              }
+             local.undoMove();
          }
      }
  
      /**
-      * @brief Gets the player's color.
-      * @return The color ("White" or "Black").
+      * @brief Prints the node count, elapsed time and nodes per second.
+      * @param nodes The number of nodes counted.
+      * @param start When counting started.
       */
-     string getColor() const { return color; }
+     static void report(long long nodes, chrono::steady_clock::time_point start) {
+         double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+         cout << "Nodes: " << nodes << "\n";
+         cout << "Time: " << (long long)(seconds * 1000) << " ms\n";
+         cout << "NPS: " << (seconds > 0 ? (long long)(nodes / seconds) : 0) << "\n";
+         cout << "Slider attacks: " << SLIDER_ATTACKS.backendName() << "\n";
+     }
  };
  
+ const size_t PGN_MAX_GAME_BYTES = 1 << 20; ///< Longest game text buffered for replay; longer games are rejected.
+ 
  /**
-  * @brief Manages the chess game, including the board and players.
+  * @brief A small PGN archive with the number of games it holds and how many should fail.
   */
- class Game {
- private:
-     ChessBoard board;        ///< The chessboard.
-     Player whitePlayer;      ///< The white player.
-     Player blackPlayer;      ///< The black player.
-     Player* currentPlayer;   ///< Pointer to the current player.
+ struct PgnCase {
+     const char* name; ///< What the case checks.
+     const char* pgn;  ///< The archive.
+     int games;        ///< Games the archive must split into.
+     int failed;       ///< Games that must be reported as invalid.
+ };
+ 
+ /**
+  * @brief Regression archives for "pgn suite".
+  */
+ const PgnCase PGN_CASES[] = {
+     {"Scholar's mate", "[Result \"1-0\"]\n\n1. e4 e5 2. Qh5 Nc6 3. Bc4 Nf6 4. Qxf7# 1-0\n", 1, 0},
+     {"Two tagless games", "1. e4 e5 2. Nf3 Nc6 1-0\n1. e4 e5 2. Ke2 Kxe5 0-1\n", 2, 1},
+     {"Two games on one line", "1. e4 e5 * 1. d4 d5 1/2-1/2 {drawn}\n", 2, 0},
+     {"Semicolon in a brace comment", "[Result \"0-1\"]\n\n1. e4 {a; b} e5 2. Ke2 (2. Nf3 Nc6) 2... Ke7 $1 1/2-1/2\n", 1, 1},
+     {"Line comment", "1. e4 ; 2. Ke2 {\ne5 *\n", 1, 0},
+     {"Tag-like comment line", "1. e4 {clock\n[%clk 0:01]} e5 *\n", 1, 0},
+     {"Unterminated comment", "[Result \"*\"]\n\n1. e4 {open 2. d4 *\n\n[Result \"*\"]\n\n1. d4 *\n", 2, 1},
+     {"Missing termination marker", "[Result \"*\"]\n\n1. e4 e5\n\n[Result \"*\"]\n\n1. d4 *\n", 2, 1},
+     {"Capture without x", "1. e4 d5 2. ed5 *\n", 1, 1},
+     {"Missing check mark", "1. f3 e5 2. g4 Qh4 0-1\n", 1, 1}
+ };
+ 
+ const int PGN_CASE_COUNT = sizeof(PGN_CASES) / sizeof(PGN_CASES[0]); ///< Number of regression archives.
  
+ /**
+  * @brief Replays PGN archives against the rules, one game per task on a pool of worker threads.
+  *
+  * The reader streams the input a line at a time and hands each complete game to the
+  * workers; it waits whenever too many games are in flight, so memory stays bounded by the
+  * window of games, whatever the size of the archive. Each worker parses the SAN moves with
+  * ChessBoard::parseSan, plays them with doMove and checks the result against the final
+  * position. Reports are printed in input order.
+  */
+ class PgnReplay {
  public:
      /**
-      * @brief Constructs a new Game, initializing the board and players.
+      * @brief Replays every game of a PGN stream and prints one report line per game and a summary.
+      * @param in The PGN text.
+      * @param threads The number of worker threads.
+      * @return True if every game was legal and its result consistent.
       */
-     Game() : whitePlayer("White"), blackPlayer("Black"), currentPlayer(&whitePlayer) {
-         board.initializeBoard();
-         initializePlayers();
+     static bool run(istream& in, int threads) {
+         chrono::steady_clock::time_point start = chrono::steady_clock::now();
+         PgnJob job(threads, cout);
+         replayStream(in, job);
+         double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+         cout << "Games: " << job.games << " (" << job.games - job.illegal - job.mismatched << " ok, " << job.illegal
+              << " with illegal moves or malformed text, " << job.mismatched << " with inconsistent results)\n";
+         cout << "Moves: " << job.plies << "\n";
+         cout << "Time: " << (long long)(seconds * 1000) << " ms\n";
+         cout << "Games per second: " << (seconds > 0 ? (long long)(job.games / seconds) : 0) << "\n";
+         return job.illegal == 0 && job.mismatched == 0;
      }
  
      /**
-      * @brief Initializes the players by assigning pieces from the board.
+      * @brief Replays every PGN_CASES archive, plus one game longer than PGN_MAX_GAME_BYTES, and
+      *        compares the game and failure counts against the expected ones.
+      * @param threads The number of worker threads.
+      * @return True if every case matched.
       */
-     void initializePlayers() {
-         for (int i = 0; i < 8; i++) {
-             for (int j = 0; j < 8; j++) {
-                 ChessPiece* piece = board.getPieceAt(i, j);
-                 if (piece) {
-                     if (piece->getColor() == "White") whitePlayer.addPiece(piece);
-                     else blackPlayer.addPiece(piece);
-                 }
+     static bool runSuite(int threads) {
+         bool allPassed = true;
+         string oversized = "1. e4 {" + string(PGN_MAX_GAME_BYTES, 'x') + "} e5 *\n1. d4 *\n";
+         for (int c = 0; c <= PGN_CASE_COUNT; c++) {
+             PgnCase test = {"Oversized game", oversized.c_str(), 2, 1};
+             if (c < PGN_CASE_COUNT) test = PGN_CASES[c];
+             istringstream in(test.pgn);
+             ostringstream reports;
+             PgnJob job(threads, reports);
+             replayStream(in, job);
+             bool passed = job.games == test.games && job.illegal + job.mismatched == test.failed;
+             cout << test.name << ": " << job.games << " games, " << job.illegal + job.mismatched << " failed"
+                  << (passed ? " ok" : " MISMATCH") << "\n";
+             if (!passed) {
+                 cerr << "PGN case " << test.name << ": expected " << test.games << " games and " << test.failed
+                      << " failed\n" << reports.str();
+                 allPassed = false;
              }
          }
+         cout << (allPassed ? "All PGN cases pass.\n" : "PGN SUITE FAILED\n");
+         return allPassed;
      }
  
      /**
-      * @brief Starts and runs the chess game loop.
+      * @brief Replays one game.
+      * @param text The game's tag pairs and movetext.
+      * @param plies Output: the number of moves played.
+      * @param status Output: 0 if valid, 1 for an illegal move, a wrong check mark, bad setup or malformed
+      *               movetext, 2 for an inconsistent result.
+      * @return The report line (without the game number).
       */
-     void startGame() {
-         bool gameOver = false;
-         while (!gameOver) {
-             board.display();
-             cout << currentPlayer->getColor() << "'s turn. Enter move (e.g., e2 e4, O-O, O-O-O) or 'resign': ";
-             string input;
-             cin >> input;
-             if (input == "resign") {
-                 cout << currentPlayer->getColor() << " resigns. "
-                      << (currentPlayer == &whitePlayer ? "Black" : "White") << " wins!\n";
-                 gameOver = true;
-                 break;
-             }
-             string from, to;
-             if (input == "O-O") {
-                 from = (currentPlayer->getColor() == "White") ? "e1" : "e8";
-                 to = (currentPlayer->getColor() == "White") ? "g1" : "g8";
-             } else if (input == "O-O-O") {
-                 from = (currentPlayer->getColor() == "White") ? "e1" : "e8";
-                 to = (currentPlayer->getColor() == "White") ? "c1" : "c8";
-             } else {
-                 from = input;
-                 cin >> to;
-             }
-             Position fromPos = algebraicToIndices(from);
-             Position toPos = algebraicToIndices(to);
-             if (fromPos.getRow() == -1 || toPos.getRow() == -1) {
-                 cout << "Invalid position format\n";
+     static string replayGame(const string& text, int& plies, int& status) {
+         string resultTag, fenTag, movetext;
+         istringstream lines(text);
+         string line;
+         while (getline(lines, line)) {
+             // Tag pairs come before the movetext; later '[' lines belong to a comment.
+             if (!line.empty() && line[0] == '[' && movetext.find_first_not_of(" \t\n") == string::npos) {
+                 size_t quote = line.find('"');
+                 size_t end = line.rfind('"');
+                 if (quote == string::npos || end <= quote) continue;
+                 string key = line.substr(1, line.find_first_of(" \t") - 1);
+                 string value = line.substr(quote + 1, end - quote - 1);
+                 if (key == "Result") resultTag = value;
+                 else if (key == "FEN") fenTag = value;
+             } else if (!line.empty() && line[0] == '%') {
                  continue;
+             } else {
+                 movetext += line;
+                 movetext += '\n';
              }
-             Move move(fromPos.getRow(), fromPos.getCol(), toPos.getRow(), toPos.getCol());
-             try {
-                 makeMove(move);
-                 string opponentColor = (currentPlayer == &whitePlayer) ? "Black" : "White";
-                 if (board.isKingInCheck(opponentColor)) {
-                     cout << opponentColor << " is in check!\n";
-                 }
-                 int state = board.isGameOver(opponentColor);
-                 if (state == GAME_CHECKMATE) {
-                     board.display();
-                     cout << "Checkmate! " << currentPlayer->getColor() << " wins!\n";
-                     gameOver = true;
-                 } else if (state == GAME_STALEMATE) {
-                     board.display();
-                     cout << "Stalemate! The game is a draw.\n";
-                     gameOver = true;
-                 } else if (board.isFiftyMoveDraw()) {
-                     board.display();
-                     cout << "Draw by 50-move rule!\n";
-                     gameOver = true;
-                 } else if (board.isThreefoldRepetition()) {
-                     board.display();
-                     cout << "Draw by threefold repetition!\n";
-                     gameOver = true;
-                 } else {
-                     switchPlayer();
+         }
+ 
+         plies = 0;
+         status = 0;
+         ChessBoard board;
+         if (fenTag.empty()) {
+             board.initializeBoard();
+         } else if (!board.loadFEN(fenTag)) {
+             status = 1;
+             return "invalid FEN tag \"" + fenTag + "\"";
+         }
+ 
+         string termination;
+         vector<string> tokens;
+         string syntaxError = movetextTokens(movetext, tokens);
+         if (!syntaxError.empty()) {
+             status = 1;
+             return "malformed movetext (" + syntaxError + ")";
+         }
+         for (size_t i = 0; i < tokens.size(); i++) {
+             const string& token = tokens[i];
+             if (isTermination(token, 0, token.size())) {
+                 termination = token;
+                 if (i + 1 < tokens.size()) {
+                     status = 1;
+                     return "malformed movetext (" + tokens[i + 1] + " after the termination marker)";
                  }
-             } catch (const char* error) {
-                 cout << "Error: " << error << "\n";
+                 break;
+             }
+             Move move = board.parseSan(token);
+             if (move.isNull()) {
+                 status = 1;
+                 return "illegal or ambiguous move " + token + " at ply " + to_string(plies + 1) + " fen " + board.toFEN();
+             }
+             board.doMove(move);
+             plies++;
+             char mark = 0;
+             if (board.isKingInCheck(board.getSideToMove()))
+                 mark = board.isGameOver(board.getSideToMove()) == GAME_CHECKMATE ? '#' : '+';
+             if (ChessBoard::sanCheckMark(token) != mark) {
+                 board.undoMove();
+                 status = 1;
+                 return "wrong check mark on " + token + " at ply " + to_string(plies) + " fen " + board.toFEN();
              }
          }
+         if (termination.empty()) {
+             status = 1;
+             return "missing game termination marker after ply " + to_string(plies) + " fen " + board.toFEN();
+         }
+ 
+         string problem;
+         int state = board.isGameOver(board.getSideToMove());
+         if (!resultTag.empty() && termination != resultTag) {
+             problem = "Result tag " + resultTag + " but movetext ends with " + termination;
+         } else if (state == GAME_CHECKMATE && termination != (board.getSideToMove() == COLOR_WHITE ? "0-1" : "1-0")) {
+             problem = "checkmate on the board but result " + termination;
+         } else if (state == GAME_STALEMATE && termination != "1/2-1/2") {
+             problem = "stalemate on the board but result " + termination;
+         }
+         if (!problem.empty()) status = 2;
+         return (problem.empty() ? string("ok") : "result mismatch (" + problem + ")") + " plies " + to_string(plies)
+                + " result " + termination + " fen " + board.toFEN();
      }
  
+ private:
      /**
-      * @brief Executes a move for the current player.
-      * @param move The move to execute.
-      * @throws const char* Error message if the move is invalid.
+      * @brief State shared by the reader and the workers.
       */
-     void makeMove(const Move& move) {
-         int fromX = move.getFromX();
-         int fromY = move.getFromY();
-         int toX = move.getToX();
-         int toY = move.getToY();
+     struct PgnJob {
+         int threads;                          ///< Number of workers.
+         ostream& out;                         ///< Where the reports go.
+         size_t window;                        ///< Most games read but not yet reported.
+         mutex lock;                           ///< Guards everything below.
+         condition_variable gameReady;         ///< Signalled when a game is queued or the input ends.
+         condition_variable slotFree;          ///< Signalled when a report is printed.
+         deque<pair<long long, string> > pending; ///< Games waiting for a worker, by number.
+         map<long long, string> reports;       ///< Finished reports waiting for earlier games.
+         long long nextGame;                   ///< Number of the next game read.
+         long long nextReport;                 ///< Number of the next report to print.
+         bool inputDone;                       ///< True once the reader reached the end of the input.
+         long long games, illegal, mismatched, plies; ///< Totals for the summary.
  
-         ChessPiece* piece = board.getPieceAt(fromX, fromY);
-         if (!piece) throw "No piece at starting position";
-         if (piece->getColor() != currentPlayer->getColor()) throw "Not your piece";
+         PgnJob(int workerCount, ostream& reports)
+             : threads(workerCount < 1 ? 1 : workerCount), out(reports), window((size_t)threads * 16), nextGame(1), nextReport(1),
+               inputDone(false), games(0), illegal(0), mismatched(0), plies(0) {}
+     };
  
-         bool needsPromotion = false;
-         if (!board.isValidMove(piece, toX, toY) || !piece->move(toX, toY, board, needsPromotion)) {
-             throw "Invalid move";
-         }
+     /**
+      * @brief Splits a PGN stream into games and replays them on the job's workers.
+      *
+      * A game ends at a tag pair that follows movetext, or right after its termination marker,
+      * so tagless games are split apart too. A game whose text grows past PGN_MAX_GAME_BYTES is
+      * not buffered further and is reported as invalid.
+      * @param in The PGN text.
+      * @param job The shared state; its totals are complete on return.
+      */
+     static void replayStream(istream& in, PgnJob& job) {
+         vector<thread> workers;
+         for (int t = 0; t < job.threads; t++) workers.push_back(thread(runWorker, ref(job)));
  
-         ChessPiece* target = board.getPieceAt(toX, toY);
-         bool isCapture = target != nullptr;
-         bool isEnPassant = false;
-         if (piece->getType() == ChessPiece::PAWN_TYPE && toY != fromY && !target &&
-             board.getPieceAt(toX, fromY)) {
-             target = board.getPieceAt(toX, fromY);
-             isCapture = true;
-             isEnPassant = true;
+         string line, text;
+         bool inMoves = false, inTags = false, inComment = false, oversized = false, lineStart, atLineStart = true;
+         vector<char> buffer(PGN_MAX_GAME_BYTES + 1);
+         while (readLine(in, buffer, line, atLineStart, lineStart)) {
+             // A tag pair starts with a letter ("[%clk ...]" lines are comment text), and closes any
+             // comment left open, so a stray '{' cannot swallow the games after it.
+             bool tagLine = lineStart && line.size() > 1 && line[0] == '[' && (line[1] | 32) >= 'a' && (line[1] | 32) <= 'z';
+             if (tagLine && inMoves) {
+                 finishGame(job, text, oversized);
+                 inMoves = false;
+             }
+             if (tagLine) inComment = false;
+             if (tagLine || (lineStart && !inComment && !line.empty() && line[0] == '%')) {
+                 inTags = inTags || tagLine;
+                 appendLine(text, line, 0, line.size(), oversized);
+                 continue;
+             }
+             size_t from = 0, end;
+             while ((end = scanMovetext(line, from, inComment, inMoves)) != string::npos) {
+                 appendLine(text, line, from, end, oversized);
+                 finishGame(job, text, oversized);
+                 inMoves = inTags = false;
+                 from = end;
+             }
+             appendLine(text, line, from, line.size(), oversized);
          }
- 
-         bool isCastling = piece->getType() == ChessPiece::KING_TYPE &&
-                          (toY - fromY == 2 || toY - fromY == -2);
-         ChessPiece* rook = nullptr;
-         int rookFromX = 0, rookFromY = 0, rookToX = 0, rookToY = 0;
-         if (isCastling) {
-             bool kingside = toY > fromY;
-             rookFromY = kingside ? 7 : 0;
-             rookToY = kingside ? 5 : 3;
-             rookFromX = rookToX = fromX;
-             rook = board.getPieceAt(rookFromX, rookFromY);
-             if (!board.canCastle(piece->getColor(), kingside)) throw "Invalid castling move";
+         if (inMoves || inTags) finishGame(job, text, oversized);
+         {
+             lock_guard<mutex> lock(job.lock);
+             job.inputDone = true;
          }
+         job.gameReady.notify_all();
+         for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+     }
  
-         board.setPieceAt(toX, toY, piece);
-         board.setPieceAt(fromX, fromY, nullptr);
+     /**
+      * @brief Reads one line, or the next PGN_MAX_GAME_BYTES of a longer one.
+      * @param in The stream to read from.
+      * @param buffer Scratch space of PGN_MAX_GAME_BYTES + 1 characters.
+      * @param line Receives the text, without its line end.
+      * @param atLineStart In and out: true if the next read starts a line.
+      * @param lineStart Output: true if the text read starts a line.
+      * @return False at the end of the input.
+      */
+     static bool readLine(istream& in, vector<char>& buffer, string& line, bool& atLineStart, bool& lineStart) {
+         lineStart = atLineStart;
+         in.getline(&buffer[0], (streamsize)buffer.size());
+         size_t count = (size_t)in.gcount();
+         bool partial = in.fail() && !in.eof() && count == buffer.size() - 1;
+         if (partial) in.clear();
+         else if (in.fail()) return false;
+         else if (!in.eof()) count--;  // The line end was extracted too.
+         line.assign(&buffer[0], count);
+         atLineStart = !partial;
+         if (atLineStart && !line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+         return true;
+     }
  
-         if (isCastling) {
-             board.setPieceAt(rookToX, rookToY, rook);
-             board.setPieceAt(rookFromX, rookFromY, nullptr);
+     /**
+      * @brief Scans movetext for the end of a game, following brace comments across lines.
+      * @param line The line.
+      * @param from Where to start scanning.
+      * @param inComment In and out: true while inside a brace comment.
+      * @param sawMove Set to true when a token outside comments is seen.
+      * @return The index just past the first termination marker, or string::npos if the line has none.
+      */
+     static size_t scanMovetext(const string& line, size_t from, bool& inComment, bool& sawMove) {
+         for (size_t i = from; i < line.size();) {
+             char c = line[i];
+             if (inComment || c == '{') {
+                 inComment = c != '}';
+                 i++;
+             } else if (c == ';') {
+                 return string::npos;
+             } else if (c == ' ' || c == '\t' || c == '(' || c == ')') {
+                 i++;
+             } else {
+                 size_t end = line.find_first_of(" \t{;()", i);
+                 if (end == string::npos) end = line.size();
+                 sawMove = true;
+                 if (isTermination(line, i, end - i)) return end;
+                 i = end;
+             }
          }
+         return string::npos;
+     }
  
-         if (isEnPassant) {
-             Player* opponent = (currentPlayer == &whitePlayer) ? &blackPlayer : &whitePlayer;
-             opponent->removePiece(target);
-             board.setPieceAt(toX, fromY, nullptr);
-             delete target;
-             target = nullptr;
-         }
+     /**
+      * @brief Checks for a game termination marker.
+      * @param text Text holding a movetext token.
+      * @param pos Start of the token.
+      * @param length Length of the token.
+      * @return True for "1-0", "0-1", "1/2-1/2" and "*".
+      */
+     static bool isTermination(const string& text, size_t pos, size_t length) {
+         if (length == 1) return text[pos] == '*';
+         if (length == 3) return text.compare(pos, 3, "1-0") == 0 || text.compare(pos, 3, "0-1") == 0;
+         return length == 7 && text.compare(pos, 7, "1/2-1/2") == 0;
+     }
  
-         if (board.isKingInCheck(currentPlayer->getColor())) {
-             board.setPieceAt(fromX, fromY, piece);
-             board.setPieceAt(toX, toY, nullptr);
-             if (isCastling) {
-                 board.setPieceAt(rookFromX, rookFromY, rook);
-                 board.setPieceAt(rookToX, rookToY, nullptr);
-             }
-             if (isEnPassant) {
-                 board.setPieceAt(toX, fromY, target);
-             }
-             piece->setPosition(fromX, fromY);
-             throw "Move puts your king in check";
+     /**
+      * @brief Appends part of a line to a game's text, dropping the text once it is too long.
+      * @param text The game's text.
+      * @param line The line.
+      * @param from Start of the part.
+      * @param end End of the part.
+      * @param oversized In and out: true once the game has exceeded PGN_MAX_GAME_BYTES.
+      */
+     static void appendLine(string& text, const string& line, size_t from, size_t end, bool& oversized) {
+         if (oversized || text.size() + (end - from) >= PGN_MAX_GAME_BYTES) {
+             oversized = true;
+             text.clear();
+             return;
          }
+         text.append(line, from, end - from);
+         text += '\n';
+     }
  
-         if (needsPromotion) {
-             string pieceType;
-             cout << "Pawn promotion! Choose piece (Queen, Rook, Bishop, Knight): ";
-             cin >> pieceType;
-             pieceType = toTitleCase(pieceType);
-             currentPlayer->removePiece(piece);
-             ChessPiece* newPiece = board.promotePawn(toX, toY, pieceType, piece->getColor());
-             if (!newPiece) {
-                 board.setPieceAt(fromX, fromY, piece);
-                 board.setPieceAt(toX, toY, nullptr);
-                 currentPlayer->addPiece(piece);
-                 throw "Invalid promotion piece";
+     /**
+      * @brief Hands a finished game to the workers, or reports it at once if it was too long.
+      * @param job The shared state.
+      * @param text The game's text, cleared on return.
+      * @param oversized In and out: whether the game exceeded PGN_MAX_GAME_BYTES, reset on return.
+      */
+     static void finishGame(PgnJob& job, string& text, bool& oversized) {
+         if (!oversized) {
+             submit(job, text);
+         } else {
+             long long number;
+             {
+                 unique_lock<mutex> lock(job.lock);
+                 while ((size_t)(job.nextGame - job.nextReport) >= job.window) job.slotFree.wait(lock);
+                 number = job.nextGame++;
              }
-             currentPlayer->addPiece(newPiece);
-             delete piece;
-             piece = newPiece;
-         }
- 
-         if (isCapture && !isEnPassant) {
-             Player* opponent = (currentPlayer == &whitePlayer) ? &blackPlayer : &whitePlayer;
-             opponent->removePiece(target);
-             delete target;
-             target = nullptr;
+             record(job, number, "game text longer than " + to_string(PGN_MAX_GAME_BYTES) + " bytes", 0, 1);
          }
- 
-         board.updateMoveHistory(fromX, fromY, toX, toY, board.getPieceAt(toX, toY), isCapture || isEnPassant);
+         text.clear();
+         oversized = false;
      }
  
      /**
-      * @brief Switches the current player to the opponent.
+      * @brief Queues a game, first waiting until the window has room.
+      * @param job The shared state.
+      * @param text The game's text.
       */
-     void switchPlayer() {
-         currentPlayer = (currentPlayer == &whitePlayer) ? &blackPlayer : &whitePlayer;
+     static void submit(PgnJob& job, const string& text) {
+         unique_lock<mutex> lock(job.lock);
+         while ((size_t)(job.nextGame - job.nextReport) >= job.window) job.slotFree.wait(lock);
+         job.pending.push_back(make_pair(job.nextGame++, text));
+         lock.unlock();
+         job.gameReady.notify_one();
      }
- };
  
- /**
-  * @brief Implements the move logic for a pawn, including forward moves, captures, en passant, and promotion.
-  * @param newX The target row.
-  * @param newY The target column.
-  * @param board The chessboard to move on.
-  * @param needsPromotion Output parameter indicating if promotion is needed.
-  * @return True if the move is valid and executed, false otherwise.
-  */
- bool Pawn::move(int newX, int newY, ChessBoard& board, bool& needsPromotion) {
-     needsPromotion = false;
-     int direction = (color == "White") ? -1 : 1;
-     int startX = (color == "White") ? 6 : 1;
-     int promotionRank = (color == "White") ? 0 : 7;
-     if (newY == y) {
-         if (newX == x + direction && !board.getPieceAt(newX, newY)) {
-             if (newX == promotionRank) needsPromotion = true;
-             setPosition(newX, newY);
-             return true;
-         }
-         if (x == startX && newX == x + 2 * direction &&
-             !board.getPieceAt(x + direction, y) && !board.getPieceAt(newX, newY)) {
-             setPosition(newX, newY);
-             return true;
+     /**
+      * @brief Replays queued games until the input is exhausted.
+      * @param job The shared state.
+      */
+     static void runWorker(PgnJob& job) {
+         while (true) {
+             pair<long long, string> game;
+             {
+                 unique_lock<mutex> lock(job.lock);
+                 while (job.pending.empty() && !job.inputDone) job.gameReady.wait(lock);
+                 if (job.pending.empty()) return;
+                 game.first = job.pending.front().first;
+                 game.second.swap(job.pending.front().second);
+                 job.pending.pop_front();
+             }
+             int plies, status;
+             string report = replayGame(game.second, plies, status);
+             record(job, game.first, report, plies, status);
          }
-     } else if (newX - x == direction && (newY - y == 1 || y - newY == 1)) {
-         ChessPiece* target = board.getPieceAt(newX, newY);
-         if (target && target->getColor() != color) {
-             if (newX == promotionRank) needsPromotion = true;
-             setPosition(newX, newY);
-             return true;
+     }
+ 
+     /**
+      * @brief Files a game's report and prints every report that is now in order.
+      * @param job The shared state.
+      * @param number The game's number.
+      * @param report The report line (without the game number).
+      * @param plies The number of moves played.
+      * @param status 0 if valid, 1 for an illegal move or malformed game, 2 for an inconsistent result.
+      */
+     static void record(PgnJob& job, long long number, const string& report, int plies, int status) {
+         {
+             lock_guard<mutex> lock(job.lock);
+             job.games++;
+             job.plies += plies;
+             if (status == 1) job.illegal++;
+             else if (status == 2) job.mismatched++;
+             job.reports[number] = report;
+             // Whoever finishes the oldest outstanding game prints every report that is now in order.
+             while (!job.reports.empty() && job.reports.begin()->first == job.nextReport) {
+                 job.out << "game " << job.nextReport << " " << job.reports.begin()->second << "\n";
+                 job.reports.erase(job.reports.begin());
+                 job.nextReport++;
+             }
          }
-         if (!target && newX == board.getLastMoveToX() &&
-             (board.getLastMoveFromX() - board.getLastMoveToX() == 2 ||
-              board.getLastMoveToX() - board.getLastMoveFromX() == 2) &&
-             board.getPieceAt(newX, y) && board.getPieceAt(newX, y)->getColor() != color) {
-             setPosition(newX, newY);
-             return true;
+         job.slotFree.notify_one();
+     }
+ 
+     /**
+      * @brief Splits movetext into SAN moves and the termination marker.
+      *
+      * Comments in braces, comments from ';' to the end of the line (outside braces),
+      * variations in parentheses (nested), numeric annotation glyphs and move numbers are dropped.
+      * @param movetext The movetext, line ends included.
+      * @param tokens Receives the remaining tokens in order.
+      * @return An empty string, or what is wrong if a comment or variation is left open or unmatched.
+      */
+     static string movetextTokens(const string& movetext, vector<string>& tokens) {
+         string token;
+         int variationDepth = 0;
+         bool inComment = false, inLineComment = false;
+         for (size_t i = 0; i <= movetext.size(); i++) {
+             char c = i < movetext.size() ? movetext[i] : '\n';
+             if (inComment) {
+                 if (c == '}') inComment = false;
+                 continue;
+             }
+             if (inLineComment) {
+                 if (c == '\n') inLineComment = false;
+                 continue;
+             }
+             bool separator = c == ' ' || c == '\t' || c == '\n' || c == '{' || c == ';' || c == '(' || c == ')';
+             if (!separator) {
+                 if (variationDepth == 0) token += c;
+                 continue;
+             }
+             if (!token.empty()) {
+                 // "12." and "12..." are move numbers; "12.e4" carries its move after the dots.
+                 size_t digits = token.find_first_not_of("0123456789");
+                 if (digits != string::npos && digits > 0 && token[digits] == '.') {
+                     token.erase(0, token.find_first_not_of('.', digits));
+                     if (token.find_first_not_of('.') == string::npos) token.clear();
+                 }
+                 if (!token.empty() && token[0] != '$') tokens.push_back(token);
+                 token.clear();
+             }
+             if (c == '{') inComment = true;
+             else if (c == ';') inLineComment = true;
+             else if (c == '(') variationDepth++;
+             else if (c == ')' && variationDepth-- == 0) return "unmatched )";
          }
+         if (inComment) return "unterminated { comment";
+         if (variationDepth > 0) return "unterminated ( variation";
+         return "";
      }
-     return false;
- }
+ };
  
  /**
   * @brief Checks if the pawn can attack a target position.
@@ -1059,41 +4887,8 @@
   * @return True if the pawn can attack the target, false otherwise.
   */
  bool Pawn::canAttack(int targetX, int targetY, const ChessBoard& board) const {
-     int direction = (color == "White") ? -1 : 1;
-     return (targetX - x == direction && (targetY - y == 1 || y - targetY == 1));
- }
- 
- /**
-  * @brief Implements the move logic for a rook, allowing horizontal and vertical moves.
-  * @param newX The target row.
-  * @param newY The target column.
-  * @param board The chessboard to move on.
-  * @param needsPromotion Output parameter (always false for rooks).
-  * @return True if the move is valid and executed, false otherwise.
-  */
- bool Rook::move(int newX, int newY, ChessBoard& board, bool& needsPromotion) {
-     needsPromotion = false;
-     if (newX == x) {
-         int startY = (y < newY) ? y + 1 : newY + 1;
-         int endY = (y < newY) ? newY : y;
-         for (int cy = startY; cy < endY; cy++) {
-             if (board.getPieceAt(x, cy)) return false;
-         }
-     } else if (newY == y) {
-         int startX = (x < newX) ? x + 1 : newX + 1;
-         int endX = (x < newX) ? newX : x;
-         for (int cx = startX; cx < endX; cx++) {
-             if (board.getPieceAt(cx, y)) return false;
-         }
-     } else {
-         return false;
-     }
-     ChessPiece* target = board.getPieceAt(newX, newY);
-     if (!target || target->getColor() != color) {
-         setPosition(newX, newY);
-         return true;
-     }
-     return false;
+     if (targetX < 0 || targetX > 7 || targetY < 0 || targetY > 7) return false;
+     return (pawnAttacks(side, squareIndex(x, y)) & squareBit(squareIndex(targetX, targetY))) != 0;
  }
  
  /**
@@ -1104,44 +4899,8 @@
   * @return True if the rook can attack the target, false otherwise.
   */
  bool Rook::canAttack(int targetX, int targetY, const ChessBoard& board) const {
-     if (targetX == x) {
-         int startY = (y < targetY) ? y + 1 : targetY + 1;
-         int endY = (y < targetY) ? targetY : y;
-         for (int cy = startY; cy < endY; cy++) {
-             if (board.getPieceAt(x, cy)) return false;
-         }
-         return true;
-     } else if (targetY == y) {
-         int startX = (x < targetX) ? x + 1 : targetX + 1;
-         int endX = (x < targetX) ? targetX : x;
-         for (int cx = startX; cx < endX; cx++) {
-             if (board.getPieceAt(cx, y)) return false;
-         }
-         return true;
-     }
-     return false;
- }
- 
- /**
-  * @brief Implements the move logic for a knight, allowing L-shaped moves.
-  * @param newX The target row.
-  * @param newY The target column.
-  * @param board The chessboard to move on.
-  * @param needsPromotion Output parameter (always false for knights).
-  * @return True if the move is valid and executed, false otherwise.
-  */
- bool Knight::move(int newX, int newY, ChessBoard& board, bool& needsPromotion) {
-     needsPromotion = false;
-     int dx = newX - x;
-     int dy = newY - y;
-     if ((dx * dx + dy * dy == 5) && !(dx == 0 || dy == 0)) {
-         ChessPiece* target = board.getPieceAt(newX, newY);
-         if (!target || target->getColor() != color) {
-             setPosition(newX, newY);
-             return true;
-         }
-     }
-     return false;
+     if (targetX < 0 || targetX > 7 || targetY < 0 || targetY > 7) return false;
+     return (rookAttacks(squareIndex(x, y), board.getOccupiedBitboard()) & squareBit(squareIndex(targetX, targetY))) != 0;
  }
  
  /**
@@ -1152,42 +4911,8 @@
   * @return True if the knight can attack the target, false otherwise.
   */
  bool Knight::canAttack(int targetX, int targetY, const ChessBoard& board) const {
-     int dx = targetX - x;
-     int dy = targetY - y;
-     return (dx * dx + dy * dy == 5) && !(dx == 0 || dy == 0);
- }
- 
- /**
-  * @brief Implements the move logic for a bishop, allowing diagonal moves.
-  * @param newX The target row.
-  * @param newY The target column.
-  * @param board The chessboard to move on.
-  * @param needsPromotion Output parameter (always false for bishops).
-  * @return True if the move is valid and executed, false otherwise.
-  */
- bool Bishop::move(int newX, int newY, ChessBoard& board, bool& needsPromotion) {
-     needsPromotion = false;
-     int dx = newX - x;
-     int dy = newY - y;
-     int absDx = (dx > 0) ? dx : -dx;
-     int absDy = (dy > 0) ? dy : -dy;
-     if (absDx == absDy && dx != 0) {
-         int stepX = (dx > 0) ? 1 : -1;
-         int stepY = (dy > 0) ? 1 : -1;
-         int cx = x + stepX;
-         int cy = y + stepY;
-         while (cx != newX) {
-             if (board.getPieceAt(cx, cy)) return false;
-             cx += stepX;
-             cy += stepY;
-         }
-         ChessPiece* target = board.getPieceAt(newX, newY);
-         if (!target || target->getColor() != color) {
-             setPosition(newX, newY);
-             return true;
-         }
-     }
-     return false;
+     if (targetX < 0 || targetX > 7 || targetY < 0 || targetY > 7) return false;
+     return (knightAttacks(squareIndex(x, y)) & squareBit(squareIndex(targetX, targetY))) != 0;
  }
  
  /**
@@ -1198,48 +4923,8 @@
   * @return True if the bishop can attack the target, false otherwise.
   */
  bool Bishop::canAttack(int targetX, int targetY, const ChessBoard& board) const {
-     int dx = targetX - x;
-     int dy = targetY - y;
-     int absDx = (dx > 0) ? dx : -dx;
-     int absDy = (dy > 0) ? dy : -dy;
-     if (absDx == absDy && dx != 0) {
-         int stepX = (dx > 0) ? 1 : -1;
-         int stepY = (dy > 0) ? 1 : -1;
-         int cx = x + stepX;
-         int cy = y + stepY;
-         while (cx != targetX) {
-             if (board.getPieceAt(cx, cy)) return false;
-             cx += stepX;
-             cy += stepY;
-         }
-         return true;
-     }
-     return false;
- }
- 
- /**
-  * @brief Implements the move logic for a queen, allowing horizontal, vertical, and diagonal moves.
-  * @param newX The target row.
-  * @param newY The target column.
-  * @param board The chessboard to move on.
-  * @param needsPromotion Output parameter (always false for queens).
-  * @return True if the move is valid and executed, false otherwise.
-  */
- bool Queen::move(int newX, int newY, ChessBoard& board, bool& needsPromotion) {
-     needsPromotion = false;
-     if (newX == x || newY == y) {
-         Rook rook(color, x, y);
-         return rook.move(newX, newY, board, needsPromotion);
-     }
-     int dx = newX - x;
-     int dy = newY - y;
-     int absDx = (dx > 0) ? dx : -dx;
-     int absDy = (dy > 0) ? dy : -dy;
-     if (absDx == absDy && dx != 0) {
-         Bishop bishop(color, x, y);
-         return bishop.move(newX, newY, board, needsPromotion);
-     }
-     return false;
+     if (targetX < 0 || targetX > 7 || targetY < 0 || targetY > 7) return false;
+     return (bishopAttacks(squareIndex(x, y), board.getOccupiedBitboard()) & squareBit(squareIndex(targetX, targetY))) != 0;
  }
  
  /**
@@ -1250,49 +4935,10 @@
   * @return True if the queen can attack the target, false otherwise.
   */
  bool Queen::canAttack(int targetX, int targetY, const ChessBoard& board) const {
-     if (targetX == x || targetY == y) {
-         Rook rook(color, x, y);
-         return rook.canAttack(targetX, targetY, board);
-     }
-     int dx = targetX - x;
-     int dy = targetY - y;
-     int absDx = (dx > 0) ? dx : -dx;
-     int absDy = (dy > 0) ? dy : -dy;
-     if (absDx == absDy && dx != 0) {
-         Bishop bishop(color, x, y);
-         return bishop.canAttack(targetX, targetY, board);
-     }
-     return false;
- }
- 
- /**
-  * @brief Implements the move logic for a king, allowing one-square moves and castling.
-  * @param newX The target row.
-  * @param newY The target column.
-  * @param board The chessboard to move on.
-  * @param needsPromotion Output parameter (always false for kings).
-  * @return True if the move is valid and executed, false otherwise.
-  */
- bool King::move(int newX, int newY, ChessBoard& board, bool& needsPromotion) {
-     needsPromotion = false;
-     int dx = newX - x;
-     int dy = newY - y;
-     int absDx = (dx > 0) ? dx : -dx;
-     int absDy = (dy > 0) ? dy : -dy;
-     if ((absDx <= 1 && absDy <= 1) && !(dx == 0 && dy == 0)) {
-         ChessPiece* target = board.getPieceAt(newX, newY);
-         if (!target || target->getColor() != color) {
-             setPosition(newX, newY);
-             return true;
-         }
-     } else if (!hasMoved && newX == x && (dy == 2 || dy == -2)) {
-         bool kingside = dy > 0;
-         if (board.canCastle(color, kingside)) {
-             setPosition(newX, newY);
-             return true;
-         }
-     }
-     return false;
+     if (targetX < 0 || targetX > 7 || targetY < 0 || targetY > 7) return false;
+     int sq = squareIndex(x, y);
+     Bitboard occupied = board.getOccupiedBitboard();
+     return ((rookAttacks(sq, occupied) | bishopAttacks(sq, occupied)) & squareBit(squareIndex(targetX, targetY))) != 0;
  }
  
  /**
@@ -1303,20 +4949,152 @@
   * @return True if the king can attack the target, false otherwise.
   */
  bool King::canAttack(int targetX, int targetY, const ChessBoard& board) const {
-     int dx = targetX - x;
-     int dy = targetY - y;
-     int absDx = (dx > 0) ? dx : -dx;
-     int absDy = (dy > 0) ? dy : -dy;
-     return (absDx <= 1 && absDy <= 1) && !(dx == 0 && dy == 0);
+     if (targetX < 0 || targetX > 7 || targetY < 0 || targetY > 7) return false;
+     return (kingAttacks(squareIndex(x, y)) & squareBit(squareIndex(targetX, targetY))) != 0;
  }
  
  /**
   * @brief Main function to start the chess game.
-  * @return 0 on successful execution.
+  *
+  * Usage:
+  *   latest_chess [--fen "<FEN>"]         play a game on the console
+  *       [--white human|engine] [--black human|engine]
+  *       [--depth <plies>] [--movetime <ms>] [--nodes <n>]   engine limits (default: 1000 ms per move)
+  *       [--hash <MB>]                    engine transposition table size (default 16)
+  *       [--ponder]                       let the engine think during the human's turn
+  *       [--multipv <n>]                  report the best n lines
+  *       [--nnue <file>]                  evaluate with a network instead of the piece-square tables
+  *   latest_chess --uci                   speak UCI on stdin/stdout
+  *   latest_chess search [FEN]            search one position with the engine limits and print the best move
+  *   latest_chess pgn <file | ->          replay and validate every game of a PGN archive
+  *   latest_chess pgn suite               check the PGN regression archives
+  *   latest_chess perft <depth> [FEN]     count leaf nodes from the start position or FEN
+  *   latest_chess divide <depth> [FEN]    same, with a count per root move
+  *   latest_chess perft suite [depth]     check the reference positions (default depth 4)
+  * Perft, search, pgn and the engine accept --threads <n> (default: all hardware threads); --fen "<FEN>"
+  * may replace the trailing FEN.
+  * @param argc Number of command-line arguments.
+  * @param argv Command-line arguments.
+  * @return 0 on successful execution, 1 on bad arguments, a perft mismatch or an invalid PGN game.
   */
- int main() 
+ int main(int argc, char* argv[]) 
  {
+     vector<string> args;
+     int threads = (int)thread::hardware_concurrency();
+     string fen;
+     bool whiteEngine = false, blackEngine = false, uci = false, ponder = false;
+     int hashMB = (int)DEFAULT_HASH_MB;
+     SearchLimits limits;
+     bool limited = false;  // Any of --depth, --movetime or --nodes given; otherwise 1000 ms per move.
+     for (int i = 1; i < argc; i++) {
+         if (string(argv[i]) == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+         else if (string(argv[i]) == "--fen" && i + 1 < argc) fen = argv[++i];
+         else if (string(argv[i]) == "--hash" && i + 1 < argc) {
+             hashMB = atoi(argv[++i]);
+             if (hashMB < 1) hashMB = 1;
+         } else if (string(argv[i]) == "--white" && i + 1 < argc) whiteEngine = string(argv[++i]) == "engine";
+         else if (string(argv[i]) == "--black" && i + 1 < argc) blackEngine = string(argv[++i]) == "engine";
+         else if (string(argv[i]) == "--depth" && i + 1 < argc) {
+             limits.depth = atoi(argv[++i]);
+             if (limits.depth < 1 || limits.depth >= MAX_PLY) limits.depth = MAX_PLY - 1;
+             limited = true;
+         } else if (string(argv[i]) == "--movetime" && i + 1 < argc) {
+             limits.moveTimeMs = atoi(argv[++i]);
+             limited = true;
+         } else if (string(argv[i]) == "--multipv" && i + 1 < argc) {
+             limits.multiPv = atoi(argv[++i]);
+             if (limits.multiPv < 1) limits.multiPv = 1;
+         } else if (string(argv[i]) == "--nodes" && i + 1 < argc) {
+             limits.nodes = atoll(argv[++i]);
+             limited = true;
+         } else if (string(argv[i]) == "--uci") uci = true;
+         else if (string(argv[i]) == "--ponder") ponder = true;
+         else if (string(argv[i]) == "--nnue" && i + 1 < argc) {
+             if (!NnueNetwork::load(argv[++i])) {
+                 cerr << "Cannot load network: " << argv[i] << "\n";
+                 return 1;
+             }
+         } else args.push_back(argv[i]);
+     }
+     if (threads < 1) threads = 1;
+     if (!limited) limits.moveTimeMs = 1000;
+ 
+     if (uci) {
+         UciEngine engine(hashMB, threads);
+         engine.loop();
+         return 0;
+     }
+ 
+     string mode = args.empty() ? "" : args[0];
+     if (mode == "perft" || mode == "divide") {
+         if (args.size() < 2) {
+             cerr << "Usage: " << argv[0] << " " << mode << " <depth> [FEN] | perft suite [depth]\n";
+             return 1;
+         }
+         if (mode == "perft" && args[1] == "suite") {
+             return Perft::runSuite(args.size() > 2 ? atoi(args[2].c_str()) : 4, threads) ? 0 : 1;
+         }
+         ChessBoard board;
+         board.initializeBoard();
+         for (size_t i = 2; i < args.size(); i++) fen += args[i] + " ";
+         if (!fen.empty()) {
+             if (!board.loadFEN(fen)) {
+                 cerr << "Invalid FEN: " << fen << "\n";
+                 return 1;
+             }
+         }
+         Perft::run(board, atoi(args[1].c_str()), mode == "divide", threads);
+         return 0;
+     }
+ 
+     if (mode == "pgn") {
+         if (args.size() < 2) {
+             cerr << "Usage: " << argv[0] << " pgn <file | - | suite>\n";
+             return 1;
+         }
+         if (args[1] == "suite") return PgnReplay::runSuite(threads) ? 0 : 1;
+         if (args[1] == "-") return PgnReplay::run(cin, threads) ? 0 : 1;
+         ifstream file(args[1].c_str());
+         if (!file) {
+             cerr << "Cannot open " << args[1] << "\n";
+             return 1;
+         }
+         return PgnReplay::run(file, threads) ? 0 : 1;
+     }
+ 
+     if (mode == "search") {
+         ChessBoard board;
+         board.initializeBoard();
+         for (size_t i = 1; i < args.size(); i++) fen += args[i] + " ";
+         if (!fen.empty() && !board.loadFEN(fen)) {
+             cerr << "Invalid FEN: " << fen << "\n";
+             return 1;
+         }
+         TranspositionTable tt(hashMB);
+         SearchResult result = Search::runThreads(board, limits, tt, threads, INFO_CONSOLE);
+         cout << "bestmove " << (result.bestMove.isNull() ? "(none)" : result.bestMove.toString()) << "\n";
+         return 0;
+     }
+ 
+     if (!fen.empty()) {
+         try {
+             Game game(fen);
+             game.setEngines(whiteEngine, blackEngine, limits);
+             if (hashMB != (int)DEFAULT_HASH_MB) game.setHashSize(hashMB);
+             game.setThreads(threads);
+             game.setPonder(ponder);
+             game.startGame();
+         } catch (const char* error) {
+             cerr << "Error: " << error << "\n";
+             return 1;
+         }
+         return 0;
+     }
      Game game;
+     game.setEngines(whiteEngine, blackEngine, limits);
+     if (hashMB != (int)DEFAULT_HASH_MB) game.setHashSize(hashMB);
+     game.setThreads(threads);
+     game.setPonder(ponder);
      game.startGame();
      return 0;
  }
\ No newline at end of file